@@ -0,0 +1,114 @@
+#include "BenchRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+namespace
+{
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        size_t middle = values.size() / 2;
+        return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    }
+}
+
+BenchRunner::BenchRunner(const std::string &filter, int repetitions, double minSampleSeconds)
+    : filter(filter), repetitions(std::max(1, repetitions)), minSampleSeconds(minSampleSeconds)
+{
+}
+
+bool BenchRunner::selected(const std::string &name) const
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+bool BenchRunner::anySelected(const std::vector<std::string> &names) const
+{
+    return std::any_of(names.begin(), names.end(), [this](const std::string &name) { return selected(name); });
+}
+
+BenchResult *BenchRunner::run(const std::string &name, const std::function<void()> &body, double itemsPerOp,
+                              double bytesPerOp)
+{
+    if (!selected(name))
+        return nullptr;
+
+    // One untimed call warms caches and page tables; its time sizes the samples
+    auto start = std::chrono::steady_clock::now();
+    body();
+    double once = std::max(secondsSince(start), 1e-9);
+    size_t iterations = static_cast<size_t>(std::min(1e6, std::max(1.0, minSampleSeconds / once)));
+
+    BenchResult result{name, iterations, {}, itemsPerOp, bytesPerOp, {}};
+    for (int sample = 0; sample < repetitions; sample++)
+    {
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            body();
+        }
+        result.samples.push_back(secondsSince(start) * 1e9 / iterations);
+    }
+
+    double ns = median(result.samples);
+    fprintf(stderr, "%-40s %14.0f ns/op", name.c_str(), ns);
+    if (itemsPerOp > 0)
+        fprintf(stderr, " %12.3g items/s", itemsPerOp * 1e9 / ns);
+    fprintf(stderr, "\n");
+
+    results.push_back(std::move(result));
+    return &results.back();
+}
+
+nlohmann::json BenchRunner::toJson() const
+{
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    char date[32] = "";
+    time_t now = time(nullptr);
+    struct tm utc;
+    if (gmtime_r(&now, &utc))
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    nlohmann::json benchmarks = nlohmann::json::array();
+    for (const BenchResult &result : results)
+    {
+        double ns = median(result.samples);
+        nlohmann::json entry = {
+            {"name", result.name},
+            {"iterations", result.iterations},
+            {"repetitions", result.samples.size()},
+            {"ns_per_op", ns},
+            {"ns_per_op_min", *std::min_element(result.samples.begin(), result.samples.end())},
+            {"ns_per_op_max", *std::max_element(result.samples.begin(), result.samples.end())},
+            {"samples_ns_per_op", result.samples},
+        };
+        if (result.itemsPerOp > 0)
+            entry["items_per_second"] = result.itemsPerOp * 1e9 / ns;
+        if (result.bytesPerOp > 0)
+            entry["bytes_per_second"] = result.bytesPerOp * 1e9 / ns;
+        for (const auto &counter : result.counters)
+        {
+            entry["counters"][counter.first] = counter.second;
+        }
+        benchmarks.push_back(entry);
+    }
+
+    return {
+        {"context",
+         {{"date", date},
+          {"host", host},
+          {"cpus", sysconf(_SC_NPROCESSORS_ONLN)},
+          {"build_type", BENCH_BUILD_TYPE},
+          {"compiler", __VERSION__}}},
+        {"benchmarks", benchmarks},
+    };
+}
@@ -0,0 +1,53 @@
+#ifndef BENCH_RUNNER_H
+#define BENCH_RUNNER_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+// Keep the compiler from discarding a result that is otherwise unused
+template <typename T>
+inline void keepResult(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Timings of one benchmark, in nanoseconds per operation
+struct BenchResult
+{
+    std::string name;
+    size_t iterations;          // Operations per sample
+    std::vector<double> samples;
+    double itemsPerOp;          // Lines, branches, frames... handled by one operation
+    double bytesPerOp;
+    std::map<std::string, double> counters; // Extra per-operation figures, e.g. terminal bytes
+};
+
+// Runs each benchmark in a few timed samples, sizing the samples so each lasts
+// at least minSampleSeconds, and reports the median so one noisy sample does
+// not move the figure. Results are written as JSON for comparing builds.
+class BenchRunner
+{
+public:
+    BenchRunner(const std::string &filter, int repetitions, double minSampleSeconds);
+
+    // Whether name passes the --filter substring; fixtures for skipped benchmarks need not be built
+    bool selected(const std::string &name) const;
+    bool anySelected(const std::vector<std::string> &names) const;
+
+    // Time body, one call per operation; returns nullptr when the benchmark is filtered out
+    BenchResult *run(const std::string &name, const std::function<void()> &body, double itemsPerOp = 0,
+                     double bytesPerOp = 0);
+
+    nlohmann::json toJson() const;
+
+private:
+    std::string filter;
+    int repetitions;
+    double minSampleSeconds;
+    std::vector<BenchResult> results;
+};
+
+#endif // BENCH_RUNNER_H
@@ -0,0 +1,162 @@
+#include "Fixtures.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ProcessRunner.h"
+
+namespace
+{
+    void runOrThrow(ProcessRunner &runner, const std::vector<std::string> &argv)
+    {
+        ProcessResult result = runner.run(argv);
+        if (result.exitCode != 0)
+            throw std::runtime_error(argv[0] + " " + argv[1] + " failed: " + result.error);
+    }
+
+    void makeDirectories(const std::string &path)
+    {
+        for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+        {
+            mkdir(path.substr(0, slash).c_str(), 0755);
+            if (slash == std::string::npos)
+                break;
+        }
+    }
+}
+
+TempDir::TempDir(const std::string &tag)
+{
+    const char *tmp = getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/gitncurses-bench-" + tag + "-XXXXXX";
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    if (!mkdtemp(name.data()))
+        throw std::runtime_error("mkdtemp failed for " + pattern);
+    dirPath = name.data();
+}
+
+TempDir::~TempDir()
+{
+    ProcessRunner runner;
+    runner.run({"rm", "-rf", "--", dirPath});
+}
+
+std::string syntheticLines(size_t count, size_t first)
+{
+    // A mix of commit headers, diff lines and status lines of typical widths
+    static const char *const shapes[] = {
+        "commit %040zx\n",
+        "Author: Bench Author <bench@example.com>\n",
+        "    Subject line of commit %zu describing the change\n",
+        "diff --git a/src/file%zu.cpp b/src/file%zu.cpp\n",
+        "@@ -%zu,7 +%zu,8 @@ void function()\n",
+        "+        int value = compute(%zu);\n",
+        "-        int value = 0;\n",
+        " M src/module/file%zu.h\n",
+    };
+    std::string text;
+    text.reserve(count * 40);
+    char line[128];
+    for (size_t i = first; i < first + count; i++)
+    {
+        int length = snprintf(line, sizeof(line), shapes[i % 8], i, i);
+        text.append(line, std::min<size_t>(length, sizeof(line) - 1));
+    }
+    return text;
+}
+
+void emitLines(int fd, size_t count)
+{
+    const size_t batch = 2048;
+    for (size_t done = 0; done < count; done += batch)
+    {
+        std::string text = syntheticLines(std::min(batch, count - done), done);
+        for (size_t written = 0; written < text.size();)
+        {
+            ssize_t n = write(fd, text.data() + written, text.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            written += n;
+        }
+    }
+}
+
+std::vector<std::string> syntheticBranchNames(size_t count)
+{
+    static const char *const shapes[] = {
+        "feature/PROJ-%zu-improve-startup-%zu",
+        "bugfix/issue-%zu-%zu",
+        "release/%zu.%zu",
+        "user/dev%zu/experiment-%zu",
+        "topic-%zu-%zu",
+    };
+    std::vector<std::string> names;
+    names.reserve(count);
+    char name[128];
+    for (size_t i = 0; i < count; i++)
+    {
+        // Scatter the leading numbers so the list is not already sorted; the index keeps names unique
+        size_t id = (i * 2654435761u) % (count * 10 + 7);
+        snprintf(name, sizeof(name), shapes[i % 5], id, i);
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::string makeCommitRepo(const std::string &dir, size_t commits)
+{
+    ProcessRunner runner;
+    runOrThrow(runner, {"git", "init", "-q", dir});
+    runOrThrow(runner, {"git", "-C", dir, "symbolic-ref", "HEAD", "refs/heads/main"});
+
+    // fast-import writes the whole history in one process, so large fixtures take seconds
+    std::string stream;
+    for (size_t i = 1; i <= commits; i++)
+    {
+        std::string message = "Commit " + std::to_string(i) + " of the bench history\n";
+        std::string contents = syntheticLines(4, i);
+        stream += "commit refs/heads/main\n";
+        stream += "mark :" + std::to_string(i) + "\n";
+        stream += "committer Bench <bench@example.com> " + std::to_string(1600000000 + i * 60) + " +0000\n";
+        stream += "data " + std::to_string(message.size()) + "\n" + message;
+        stream += "M 100644 inline file" + std::to_string(i % 50) + ".txt\n";
+        stream += "data " + std::to_string(contents.size()) + "\n" + contents + "\n";
+    }
+    stream += "get-mark :" + std::to_string(commits) + "\n";
+
+    ProcessResult result = runner.runWithInput({"git", "-C", dir, "fast-import", "--quiet"}, stream);
+    if (result.exitCode != 0)
+        throw std::runtime_error("git fast-import failed: " + result.error);
+    runOrThrow(runner, {"git", "-C", dir, "reset", "-q", "--hard"});
+    return result.output.substr(0, result.output.find('\n'));
+}
+
+void addBranches(const std::string &dir, const std::string &oid, const std::vector<std::string> &names,
+                 size_t loose)
+{
+    loose = std::min(loose, names.size());
+    size_t packedCount = names.size() - loose;
+
+    std::vector<std::string> packed(names.begin(), names.begin() + packedCount);
+    std::sort(packed.begin(), packed.end());
+    std::ofstream refs(dir + "/.git/packed-refs");
+    refs << "# pack-refs with: peeled fully-peeled sorted \n";
+    for (const std::string &name : packed)
+    {
+        refs << oid << " refs/heads/" << name << "\n";
+    }
+
+    for (size_t i = packedCount; i < names.size(); i++)
+    {
+        std::string path = dir + "/.git/refs/heads/" + names[i];
+        makeDirectories(path.substr(0, path.rfind('/')));
+        std::ofstream(path) << oid << "\n";
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <string>
+#include <vector>
+
+// Scratch directory under $TMPDIR, removed with everything in it on destruction
+class TempDir
+{
+public:
+    explicit TempDir(const std::string &tag);
+    ~TempDir();
+
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    const std::string &path() const { return dirPath; }
+
+private:
+    std::string dirPath;
+};
+
+// Output lines in the shapes git prints (log, diff, status), numbered from first
+std::string syntheticLines(size_t count, size_t first = 0);
+
+// Write count synthetic lines to fd; the fake git the process benchmarks spawn
+void emitLines(int fd, size_t count);
+
+// Branch names mixing the usual naming schemes, in no particular order
+std::vector<std::string> syntheticBranchNames(size_t count);
+
+// Create a repository at dir holding a linear history of commits on main, checked out.
+// Returns the id of the last commit; throws when git fails.
+std::string makeCommitRepo(const std::string &dir, size_t commits);
+
+// Point every name at oid: the last loose names as loose ref files, the others in packed-refs
+void addBranches(const std::string &dir, const std::string &oid, const std::vector<std::string> &names,
+                 size_t loose);
+
+#endif // FIXTURES_H
@@ -0,0 +1,198 @@
+#include "PtySession.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    const size_t kMaxText = 4 * 1024 * 1024;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+PtySession::PtySession() : pid(-1), master(-1), bytesRead(0), escape(Escape::None)
+{
+}
+
+PtySession::~PtySession()
+{
+    stop();
+}
+
+void PtySession::start(const std::string &program, const std::string &dir, int rows, int columns,
+                       const std::string &term)
+{
+    // The environment is built before forking: the child may only make async-signal-safe calls
+    std::vector<std::string> variables;
+    for (char **variable = environ; *variable; variable++)
+    {
+        if (strncmp(*variable, "TERM=", 5) != 0)
+            variables.push_back(*variable);
+    }
+    variables.push_back("TERM=" + term);
+    std::vector<char *> envp;
+    for (std::string &variable : variables)
+    {
+        envp.push_back(&variable[0]);
+    }
+    envp.push_back(nullptr);
+    char *const argv[] = {const_cast<char *>(program.c_str()), nullptr};
+
+    struct winsize size = {};
+    size.ws_row = static_cast<unsigned short>(rows);
+    size.ws_col = static_cast<unsigned short>(columns);
+
+    pid = forkpty(&master, nullptr, nullptr, &size);
+    if (pid < 0)
+        throw std::runtime_error("forkpty failed");
+    if (pid == 0)
+    {
+        if (chdir(dir.c_str()) != 0)
+            _exit(126);
+        execve(program.c_str(), argv, envp.data());
+        _exit(127);
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    fcntl(master, F_SETFD, FD_CLOEXEC);
+}
+
+void PtySession::stop()
+{
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        pid = -1;
+    }
+    if (master >= 0)
+    {
+        close(master);
+        master = -1;
+    }
+}
+
+Paint PtySession::send(std::string_view keys, int settleMs, int timeoutMs)
+{
+    // Output left over from an earlier update must not count towards this one
+    char buffer[65536];
+    ssize_t pending;
+    while ((pending = read(master, buffer, sizeof(buffer))) > 0 || (pending < 0 && errno == EINTR))
+    {
+        bytesRead += std::max<ssize_t>(pending, 0);
+        record(buffer, std::max<ssize_t>(pending, 0));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    while (!keys.empty())
+    {
+        ssize_t n = write(master, keys.data(), keys.size());
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (n < 0)
+            throw std::runtime_error("write to terminal failed");
+        keys.remove_prefix(n);
+    }
+
+    Paint paint{false, 0, 0, 0};
+    while (true)
+    {
+        double elapsed = millisecondsSince(start);
+        double wait = paint.painted ? paint.lastByteMs + settleMs - elapsed : timeoutMs - elapsed;
+        wait = std::min(wait, timeoutMs - elapsed);
+        if (wait < 0)
+            break;
+
+        struct pollfd pfd = {master, POLLIN, 0};
+        int ready = poll(&pfd, 1, static_cast<int>(wait) + 1);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            break;
+
+        ssize_t n = read(master, buffer, sizeof(buffer));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (n <= 0)
+            break; // The program exited and the slave side closed
+        double now = millisecondsSince(start);
+        if (!paint.painted)
+            paint.firstByteMs = now;
+        paint.painted = true;
+        paint.lastByteMs = now;
+        paint.bytes += n;
+        bytesRead += n;
+        record(buffer, n);
+    }
+    return paint;
+}
+
+Paint PtySession::drain(int settleMs, int timeoutMs)
+{
+    return send(std::string_view(), settleMs, timeoutMs);
+}
+
+std::string PtySession::takeText()
+{
+    std::string taken;
+    taken.swap(text);
+    return taken;
+}
+
+void PtySession::record(const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        switch (escape)
+        {
+        case Escape::None:
+            if (c == 0x1b)
+                escape = Escape::Start;
+            else if (c >= 0x20 && c != 0x7f)
+                text += static_cast<char>(c);
+            break;
+        case Escape::Start:
+            if (c == '[')
+                escape = Escape::Sequence;
+            else if (c == ']')
+                escape = Escape::String;
+            else if (c == '(' || c == ')')
+                escape = Escape::Charset;
+            else
+                escape = Escape::None;
+            break;
+        case Escape::Sequence:
+            if (c >= 0x40 && c <= 0x7e)
+                escape = Escape::None;
+            break;
+        case Escape::String:
+            if (c == 0x07)
+                escape = Escape::None;
+            else if (c == 0x1b)
+                escape = Escape::Start;
+            break;
+        case Escape::Charset:
+            escape = Escape::None;
+            break;
+        }
+    }
+    // Only recent updates are ever checked; scrolling a huge log must not keep all of it
+    if (text.size() > kMaxText)
+        text.erase(0, text.size() - kMaxText / 2);
+}
@@ -0,0 +1,64 @@
+#ifndef PTY_SESSION_H
+#define PTY_SESSION_H
+
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// Terminal output that followed one input, timed from the moment it was written
+struct Paint
+{
+    bool painted;       // Any output arrived before the timeout
+    double firstByteMs;
+    double lastByteMs;  // End of the update: nothing followed for the settle time
+    size_t bytes;
+};
+
+// Runs a program on the slave side of a pseudo-terminal, as a terminal
+// emulator would, and timestamps everything it writes. An update counts as
+// finished once the program has been silent for the settle time.
+class PtySession
+{
+public:
+    PtySession();
+    ~PtySession();
+
+    PtySession(const PtySession &) = delete;
+    PtySession &operator=(const PtySession &) = delete;
+
+    // Start argv[0] in dir on a rows x columns terminal of the given type; throws on failure
+    void start(const std::string &program, const std::string &dir, int rows, int columns,
+               const std::string &term = "xterm-256color");
+    void stop();
+
+    // Write keys, then collect output until it settles or timeoutMs have passed
+    Paint send(std::string_view keys, int settleMs, int timeoutMs);
+    // Collect output without sending anything: startup, long-running commands
+    Paint drain(int settleMs, int timeoutMs);
+
+    size_t totalBytes() const { return bytesRead; }
+
+    // Characters written since the last call with control and escape sequences removed: what
+    // was drawn, not where. Cells ncurses found unchanged on screen are not sent, so not here either.
+    std::string takeText();
+
+private:
+    enum class Escape
+    {
+        None,
+        Start,    // After ESC
+        Sequence, // CSI: parameters up to a final byte
+        String,   // OSC: up to BEL or ESC
+        Charset,  // ESC ( and friends take one more byte
+    };
+
+    pid_t pid;
+    int master;
+    size_t bytesRead;
+    std::string text;
+    Escape escape;
+
+    void record(const char *data, size_t size);
+};
+
+#endif // PTY_SESSION_H
@@ -0,0 +1,437 @@
+// Micro-benchmarks for the hot paths of gitNCurses: running git and
+// collecting its output, splitting output into lines, reading and querying
+// local branches, and redrawing the screen. Inputs are synthetic and fixture
+// repositories are generated on the fly, so runs are repeatable on any machine.
+//
+// Usage: gitNCurses-bench [--out FILE] [--filter TEXT] [--repetitions N]
+//                         [--min-time SECONDS] [--max-lines N] [--commits N]
+// Progress goes to stderr; JSON results go to FILE, or stdout without --out.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits.h>
+#include <ncurses.h>
+#include <panel.h>
+#include <unistd.h>
+#include "BenchRunner.h"
+#include "Fixtures.h"
+#include "BranchSet.h"
+#include "GitCommandHandler.h"
+#include "OutputBuffer.h"
+#include "ProcessRunner.h"
+#include "RefReader.h"
+#include "ScreenRenderer.h"
+
+namespace
+{
+    struct Options
+    {
+        std::string out;
+        std::string filter;
+        int repetitions = 5;
+        double minTime = 0.1;
+        size_t maxLines = 10000000;
+        size_t commits = 10000;
+    };
+
+    std::string selfPath;
+
+    std::string sizeLabel(size_t n)
+    {
+        if (n >= 1000000 && n % 1000000 == 0)
+            return std::to_string(n / 1000000) + "M";
+        if (n >= 1000 && n % 1000 == 0)
+            return std::to_string(n / 1000) + "K";
+        return std::to_string(n);
+    }
+
+    std::vector<size_t> lineCounts(const Options &options)
+    {
+        std::vector<size_t> counts;
+        for (size_t n = 1000; n <= options.maxLines; n *= 10)
+        {
+            counts.push_back(n);
+        }
+        return counts;
+    }
+
+    // Runs code with the working directory set to dir, as the app runs inside the repository
+    class WorkingDirectory
+    {
+    public:
+        explicit WorkingDirectory(const std::string &dir)
+        {
+            if (!getcwd(previous, sizeof(previous)) || chdir(dir.c_str()) != 0)
+                throw std::runtime_error("cannot enter " + dir);
+        }
+        ~WorkingDirectory()
+        {
+            if (chdir(previous) != 0)
+                perror("chdir");
+        }
+
+    private:
+        char previous[PATH_MAX];
+    };
+
+    void benchProcess(BenchRunner &bench, const Options &options)
+    {
+        // The fake git is this binary in --emit-lines mode: no repository, just a pipe full of lines
+        ProcessRunner runner;
+        bench.run("process/spawn", [&]
+                  { keepResult(runner.run({selfPath, "--emit-lines", "0"})); });
+
+        for (size_t lines : lineCounts(options))
+        {
+            std::string name = "process/collect/" + sizeLabel(lines);
+            if (!bench.selected(name))
+                continue;
+            std::string count = std::to_string(lines);
+            size_t bytes = runner.run({selfPath, "--emit-lines", count}).output.size();
+            bench.run(name, [&]
+                      { keepResult(runner.run({selfPath, "--emit-lines", count})); },
+                      lines, bytes);
+        }
+    }
+
+    void benchGit(BenchRunner &bench, const Options &options)
+    {
+        std::string label = sizeLabel(options.commits);
+        if (!bench.anySelected({"git/execute/log-oneline/" + label, "git/execute/log/" + label, "git/execute/status",
+                                "git/repo-state"}))
+            return;
+
+        TempDir dir("repo");
+        fprintf(stderr, "creating fixture repository with %zu commits\n", options.commits);
+        makeCommitRepo(dir.path(), options.commits);
+        WorkingDirectory inside(dir.path());
+        GitCommandHandler handler;
+
+        bench.run("git/execute/log-oneline/" + label, [&]
+                  { keepResult(handler.executeCommand("log --oneline")); },
+                  options.commits);
+        bench.run("git/execute/log/" + label, [&]
+                  { keepResult(handler.executeCommand("log")); },
+                  options.commits);
+        bench.run("git/execute/status", [&]
+                  { keepResult(handler.executeCommand("status")); });
+        bench.run("git/repo-state", [&]
+                  {
+                      handler.invalidateRepoState();
+                      keepResult(handler.getRepoState());
+                  });
+    }
+
+    void benchOutput(BenchRunner &bench, const Options &options)
+    {
+        // Text is generated once and repeated for the largest sizes, like a pipe delivering 64 KiB reads
+        std::vector<size_t> counts = lineCounts(options);
+        if (counts.empty())
+            return;
+        const size_t textLines = std::min<size_t>(counts.back(), 1000000);
+        std::string text = syntheticLines(textLines);
+        const size_t readSize = 64 * 1024;
+
+        // The app's own configuration: 256 KiB chunks, spilling past the default 64 MiB scrollback limit
+        OutputBuffer buffer(256 * 1024, 64 * 1024 * 1024);
+        for (size_t lines : counts)
+        {
+            size_t repeats = lines / textLines;
+            std::string partText = repeats ? std::string() : syntheticLines(lines);
+            const std::string &source = repeats ? text : partText;
+            repeats = std::max<size_t>(repeats, 1);
+
+            auto ingest = [&]
+            {
+                buffer.clear();
+                for (size_t r = 0; r < repeats; r++)
+                {
+                    for (size_t offset = 0; offset < source.size(); offset += readSize)
+                    {
+                        buffer.append(source.data() + offset, std::min(readSize, source.size() - offset));
+                    }
+                }
+            };
+            bench.run("output/append/" + sizeLabel(lines), ingest, lines, source.size() * repeats);
+
+            std::string name = "output/read-lines/" + sizeLabel(lines);
+            if (!bench.selected(name))
+                continue;
+            ingest();
+            bench.run(name, [&]
+                      {
+                          size_t total = 0;
+                          for (size_t i = 0; i < buffer.lineCount(); i++)
+                          {
+                              total += buffer.line(i).size();
+                          }
+                          keepResult(total);
+                      },
+                      buffer.lineCount());
+        }
+    }
+
+    void benchBranches(BenchRunner &bench)
+    {
+        for (size_t count : {100, 1000, 10000, 100000})
+        {
+            std::string label = sizeLabel(count);
+            if (!bench.anySelected({"branches/read/" + label, "branches/git-branch/" + label, "branches/set/" + label,
+                                    "branches/prefix/" + label}))
+                continue;
+
+            std::vector<std::string> names = syntheticBranchNames(count);
+            TempDir dir("branches");
+            std::string oid = makeCommitRepo(dir.path(), 1);
+            addBranches(dir.path(), oid, names, std::min<size_t>(count / 10, 64));
+            WorkingDirectory inside(dir.path());
+
+            {
+                GitCommandHandler handler;
+                bench.run("branches/read/" + label, [&]
+                          { keepResult(handler.getLocalBranches()); },
+                          count);
+            }
+
+            // With GIT_DIR set the .git reader steps aside and `git branch` output is parsed instead
+            setenv("GIT_DIR", (dir.path() + "/.git").c_str(), 1);
+            {
+                GitCommandHandler handler;
+                bench.run("branches/git-branch/" + label, [&]
+                          { keepResult(handler.getLocalBranches()); },
+                          count);
+            }
+            unsetenv("GIT_DIR");
+
+            bench.run("branches/set/" + label, [&]
+                      {
+                          BranchSet set;
+                          set.assign(names);
+                          keepResult(set);
+                      },
+                      count);
+
+            BranchSet set;
+            set.assign(names);
+            bench.run("branches/prefix/" + label, [&]
+                      { keepResult(set.withPrefix("feature/PROJ-1", 50)); });
+        }
+    }
+
+    // Screen of the app's shape: menu bar, output pane, input line and status bar
+    struct Screen
+    {
+        FILE *terminal = nullptr; // Everything ncurses sends ends up here, so frames can be measured in bytes
+        SCREEN *screen = nullptr;
+        WINDOW *menuWin = nullptr;
+        WINDOW *outputWin = nullptr;
+        WINDOW *inputWin = nullptr;
+        WINDOW *statusWin = nullptr;
+
+        bool open(int rows, int columns)
+        {
+            terminal = tmpfile();
+            FILE *input = fopen("/dev/null", "r");
+            if (!terminal || !input)
+                return false;
+            screen = newterm("xterm-256color", terminal, input);
+            if (!screen)
+                return false;
+            resizeterm(rows, columns);
+            start_color();
+            init_pair(3, COLOR_CYAN, COLOR_BLACK);
+            init_pair(4, COLOR_WHITE, COLOR_BLUE);
+            init_pair(5, COLOR_BLACK, COLOR_WHITE);
+            menuWin = newwin(3, columns, 0, 0);
+            outputWin = newwin(rows - 7, columns, 3, 0);
+            inputWin = newwin(3, columns, rows - 4, 0);
+            statusWin = newwin(1, columns, rows - 1, 0);
+            wbkgd(statusWin, COLOR_PAIR(5));
+            return true;
+        }
+
+        void close()
+        {
+            if (!screen)
+                return;
+            for (WINDOW *win : {menuWin, outputWin, inputWin, statusWin})
+            {
+                delwin(win);
+            }
+            endwin();
+            delscreen(screen);
+            fclose(terminal);
+            screen = nullptr;
+        }
+
+        long sent() const { return ftell(terminal); }
+    };
+
+    void benchRender(BenchRunner &bench)
+    {
+        if (!bench.anySelected({"render/menu-bar", "render/output-scroll-line", "render/output-page-down",
+                                "render/unchanged-frame"}))
+            return;
+
+        Screen screen;
+        if (!screen.open(30, 100))
+        {
+            fprintf(stderr, "render benchmarks skipped: no xterm-256color terminfo entry\n");
+            return;
+        }
+
+        {
+            ScreenRenderer renderer;
+            renderer.setBaseWindows({screen.menuWin, screen.outputWin, screen.inputWin, screen.statusWin});
+            renderer.flush();
+
+            OutputBuffer buffer;
+            buffer.append(syntheticLines(100000));
+            const int visibleLines = getmaxy(screen.outputWin) - 2;
+            const int lastTop = static_cast<int>(buffer.lineCount()) - visibleLines;
+
+            // Each benchmark reports the terminal bytes its frames cost next to their time
+            auto measure = [&](const std::string &name, const std::function<void()> &frame)
+            {
+                long before = screen.sent();
+                size_t frames = 0;
+                BenchResult *result = bench.run(name, [&]
+                                                {
+                                                    frame();
+                                                    frames++;
+                                                },
+                                                1);
+                if (result && frames)
+                    result->counters["terminal_bytes_per_frame"] =
+                        static_cast<double>(screen.sent() - before) / frames;
+            };
+
+            const std::vector<std::string> menus = {"File", "Repository", "Branch", "Remote",
+                                                    "History", "Stash", "Tag", "Help"};
+            size_t selected = 0;
+            measure("render/menu-bar", [&]
+                    {
+                        selected = (selected + 1) % menus.size();
+                        ScreenRenderer::drawMenuBar(screen.menuWin, menus, selected, COLOR_PAIR(3), COLOR_PAIR(4));
+                        renderer.markDirty(screen.menuWin);
+                        renderer.flush();
+                    });
+
+            // Plain command output, painted the way GitNCurses::renderOutput paints it
+            auto drawOutput = [&](int first)
+            {
+                werase(screen.outputWin);
+                box(screen.outputWin, 0, 0);
+                ScreenRenderer::drawRows(screen.outputWin, buffer.lineCount(), first, [&](size_t index)
+                                         { return buffer.line(index); });
+            };
+
+            int top = 0;
+            measure("render/output-scroll-line", [&]
+                    {
+                        top = top < lastTop ? top + 1 : 0;
+                        drawOutput(top);
+                        renderer.markDirty(screen.outputWin);
+                        renderer.flush();
+                    });
+
+            top = 0;
+            measure("render/output-page-down", [&]
+                    {
+                        top = top + visibleLines <= lastTop ? top + visibleLines : 0;
+                        drawOutput(top);
+                        renderer.markDirty(screen.outputWin);
+                        renderer.flush();
+                    });
+
+            measure("render/unchanged-frame", [&]
+                    {
+                        drawOutput(top);
+                        renderer.markDirty(screen.outputWin);
+                        renderer.flush();
+                    });
+
+            renderer.setBaseWindows({});
+        }
+        screen.close();
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            std::string value = argv[++i];
+            if (arg == "--out")
+                options.out = value;
+            else if (arg == "--filter")
+                options.filter = value;
+            else if (arg == "--repetitions")
+                options.repetitions = atoi(value.c_str());
+            else if (arg == "--min-time")
+                options.minTime = atof(value.c_str());
+            else if (arg == "--max-lines")
+                options.maxLines = strtoull(value.c_str(), nullptr, 10);
+            else if (arg == "--commits")
+                options.commits = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 10));
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // Fake git mode used by the process benchmarks
+    if (argc == 3 && strcmp(argv[1], "--emit-lines") == 0)
+    {
+        emitLines(STDOUT_FILENO, strtoull(argv[2], nullptr, 10));
+        return 0;
+    }
+
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--out FILE] [--filter TEXT] [--repetitions N] [--min-time SECONDS] "
+                        "[--max-lines N] [--commits N]\n",
+                argv[0]);
+        return 2;
+    }
+
+    char self[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    selfPath = length > 0 ? std::string(self, length) : std::string(argv[0]);
+
+    BenchRunner bench(options.filter, options.repetitions, options.minTime);
+    try
+    {
+        benchProcess(bench, options);
+        benchGit(bench, options);
+        benchOutput(bench, options);
+        benchBranches(bench);
+        benchRender(bench);
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "bench: %s\n", e.what());
+        return 1;
+    }
+
+    std::string json = bench.toJson().dump(2) + "\n";
+    if (options.out.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream(options.out) << json;
+        fprintf(stderr, "results written to %s\n", options.out.c_str());
+    }
+    return 0;
+}
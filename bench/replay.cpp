@@ -0,0 +1,408 @@
+// Keystroke-to-paint latency of the real gitNCurses binary. The program runs
+// on a pseudo-terminal inside a generated fixture repository while scripted
+// key sequences are replayed; each key is timed from the write to the end of
+// the terminal update it caused, and the bytes of that update are counted.
+//
+// Usage: gitNCurses-replay [--binary PATH] [--data-dir DIR] [--out FILE]
+//                          [--scenario NAME] [--script FILE] [--commits N] [--branches N]
+//                          [--settle MS] [--timeout MS] [--max-p99 MS]
+//
+// Scripts are whitespace-separated tokens, '#' starts a comment:
+//   Up Down Left Right Enter Tab Esc Space Backspace PgUp PgDn Home End
+//                 one timed key; append *N to repeat it, e.g. Down*20
+//   G, j, ...     any single character is typed as a timed key too
+//   text:abc      each character typed as a timed key
+//   wait:MS       untimed: let the program run until output stops, at most MS
+//   sleep:MS      untimed pause
+//   shell: CMD    untimed: run the rest of the line with sh in the fixture repository
+//   expect: TEXT  fail the run unless the rest of the line was drawn after the
+//                 previous check; checks in a row look at the same output
+//   reject: TEXT  fail the run if it was (see PtySession::takeText for what counts)
+// With --max-p99 the exit status is 1 when any scenario's p99 latency exceeds MS.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "Fixtures.h"
+#include "PtySession.h"
+#include "json.hpp"
+
+namespace
+{
+    struct Options
+    {
+        std::string binary = GITNCURSES_BINARY;
+        std::string dataDir = GITNCURSES_SOURCE_DIR;
+        std::string out;
+        std::string scenario;
+        std::string script;
+        size_t commits = 20000;
+        size_t branches = 5000;
+        int rows = 30;
+        int columns = 100;
+        int settleMs = 30;
+        int timeoutMs = 2000;
+        double maxP99 = 0;
+    };
+
+    struct Scenario
+    {
+        std::string name;
+        std::string script;
+    };
+
+    // Start from the menu bar with nothing open
+    const std::vector<Scenario> builtinScenarios = {
+        {"menu-navigation", "Right*7 Left*7 "
+                            "Right Enter Down*5 Up*5 Esc "
+                            "Right Enter Down*3 Esc"},
+        {"checkout", "Right*2 Enter Down Enter " // Branch > Checkout lists every branch
+                     "Down*30 PgDn*10 End Home "
+                     "text:feature/PROJ-1 Backspace*4 Esc Esc Esc"},
+        // Huge output in the pane; it follows the tail while streaming, so scrolling starts upwards
+        {"log-scroll", "text:i text:log Space text:--stat Enter wait:60000 "
+                       "Tab PgUp*40 Up*40 G PgUp*20 Down*20"},
+        {"log-view", "Right*4 Enter Enter wait:5000 " // History > Log, paged from a live git log
+                     "Tab PgDn*40 Down*40 G wait:60000 PgUp*20 Up*20"},
+        // Checks of what is drawn; they change the fixture, so they run last
+        {"complete-branch", "text:i text:checkout Space text:t Tab\n" // Over a thousand topic-* branches
+                            "expect: opic-\n"
+                            "reject: opic-1\n" // Only the first fifty or so share it
+                            "Esc"},
+        {"blame-after-commit", "shell: git config user.name Bench && git config user.email bench@example.com\n"
+                               "shell: echo extra >> file1.txt\n"
+                               "text:i text:blame Enter text:file1.txt Tab Enter wait:5000\n"
+                               "expect: Not Committe\n"
+                               "Esc text:i text:add Space text:file1.txt Enter wait:5000 "
+                               "Esc text:i text:commit Space text:check Enter wait:5000 "
+                               "Esc text:i text:blame Enter text:file1.txt Tab Enter wait:5000\n"
+                               "reject: Not Committe\n"},
+    };
+
+    const std::map<std::string, std::string> keyNames = {
+        {"Up", "\033OA"},      {"Down", "\033OB"},   {"Right", "\033OC"}, {"Left", "\033OD"},
+        {"Home", "\033OH"},    {"End", "\033OF"},    {"PgUp", "\033[5~"}, {"PgDn", "\033[6~"},
+        {"Enter", "\r"},       {"Tab", "\t"},        {"Esc", "\033"},     {"Space", " "},
+        {"Backspace", "\177"},
+    };
+
+    struct KeySample
+    {
+        std::string key;
+        Paint paint;
+    };
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100 * values.size() + 0.999999);
+        return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    nlohmann::json latencySummary(const std::vector<double> &values)
+    {
+        double total = 0;
+        for (double value : values)
+        {
+            total += value;
+        }
+        return {
+            {"count", values.size()},
+            {"mean", values.empty() ? 0 : total / values.size()},
+            {"p50", percentile(values, 50)},
+            {"p90", percentile(values, 90)},
+            {"p99", percentile(values, 99)},
+            {"max", values.empty() ? 0 : *std::max_element(values.begin(), values.end())},
+        };
+    }
+
+    std::string restOfLine(std::istringstream &tokens)
+    {
+        std::string line;
+        std::getline(tokens, line);
+        size_t first = line.find_first_not_of(" \t");
+        size_t last = line.find_last_not_of(" \t\r");
+        return first == std::string::npos ? "" : line.substr(first, last - first + 1);
+    }
+
+    std::vector<KeySample> replay(PtySession &session, const std::string &script, const std::string &dir,
+                                  const Options &options)
+    {
+        std::vector<KeySample> samples;
+        std::istringstream tokens(script);
+        std::string token;
+        std::string drawn; // Text drawn since the keys that followed the previous checks
+        bool checked = false;
+        while (tokens >> token)
+        {
+            if (token[0] == '#')
+            {
+                restOfLine(tokens);
+                continue;
+            }
+            if (token == "shell:")
+            {
+                std::string command = restOfLine(tokens);
+                if (system(("cd '" + dir + "' && " + command).c_str()) != 0)
+                    throw std::runtime_error("shell command failed: " + command);
+                continue;
+            }
+            if (token == "expect:" || token == "reject:")
+            {
+                std::string text = restOfLine(tokens);
+                drawn += session.takeText();
+                checked = true;
+                bool found = drawn.find(text) != std::string::npos;
+                if (found != (token == "expect:"))
+                    throw std::runtime_error((found ? "drawn but rejected: " : "never drawn: ") + text);
+                continue;
+            }
+            if (checked)
+            {
+                // Keys after a group of checks start a new window for the next one
+                session.takeText();
+                drawn.clear();
+                checked = false;
+            }
+            if (token.compare(0, 5, "wait:") == 0)
+            {
+                session.drain(300, atoi(token.c_str() + 5));
+                continue;
+            }
+            if (token.compare(0, 6, "sleep:") == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(atoi(token.c_str() + 6)));
+                continue;
+            }
+            if (token.compare(0, 5, "text:") == 0)
+            {
+                for (char ch : token.substr(5))
+                {
+                    samples.push_back({std::string(1, ch), session.send(std::string(1, ch), options.settleMs,
+                                                                         options.timeoutMs)});
+                }
+                continue;
+            }
+
+            size_t star = token.find('*');
+            std::string name = token.substr(0, star);
+            int repeat = star == std::string::npos ? 1 : atoi(token.c_str() + star + 1);
+            auto key = keyNames.find(name);
+            if (key == keyNames.end() && name.size() != 1)
+                throw std::runtime_error("unknown key in script: " + token);
+            std::string bytes = key == keyNames.end() ? name : key->second;
+            for (int i = 0; i < repeat; i++)
+            {
+                samples.push_back({name, session.send(bytes, options.settleMs, options.timeoutMs)});
+            }
+        }
+        return samples;
+    }
+
+    nlohmann::json summarize(const Scenario &scenario, const std::vector<KeySample> &samples, double startupMs)
+    {
+        std::vector<double> latency, firstByte, bytes;
+        std::map<std::string, std::vector<double>> byKey;
+        size_t silent = 0;
+        size_t totalBytes = 0;
+        nlohmann::json keys = nlohmann::json::array();
+        for (const KeySample &sample : samples)
+        {
+            totalBytes += sample.paint.bytes;
+            keys.push_back({{"key", sample.key},
+                            {"painted", sample.paint.painted},
+                            {"latency_ms", sample.paint.lastByteMs},
+                            {"bytes", sample.paint.bytes}});
+            if (!sample.paint.painted)
+            {
+                silent++;
+                continue;
+            }
+            latency.push_back(sample.paint.lastByteMs);
+            firstByte.push_back(sample.paint.firstByteMs);
+            bytes.push_back(static_cast<double>(sample.paint.bytes));
+            byKey[sample.key].push_back(sample.paint.lastByteMs);
+        }
+
+        nlohmann::json perKey = nlohmann::json::object();
+        for (const auto &entry : byKey)
+        {
+            perKey[entry.first] = latencySummary(entry.second);
+        }
+
+        nlohmann::json summary = latencySummary(latency);
+        fprintf(stderr, "%-16s %4zu keys  p50 %7.2f ms  p90 %7.2f ms  p99 %7.2f ms  max %7.2f ms  %9zu bytes\n",
+                scenario.name.c_str(), samples.size(), summary["p50"].get<double>(), summary["p90"].get<double>(),
+                summary["p99"].get<double>(), summary["max"].get<double>(), totalBytes);
+
+        return {
+            {"name", scenario.name},
+            {"script", scenario.script},
+            {"startup_ms", startupMs},
+            {"keys", samples.size()},
+            {"keys_without_output", silent},
+            {"latency_ms", summary},
+            {"first_byte_ms", latencySummary(firstByte)},
+            {"bytes_total", totalBytes},
+            {"bytes_per_key", latencySummary(bytes)},
+            {"latency_ms_by_key", perKey},
+            {"samples", keys},
+        };
+    }
+
+    // Fixture: a long linear history with many branches, plus the menu and help files the app loads from its cwd
+    void prepareFixture(const TempDir &dir, const Options &options)
+    {
+        fprintf(stderr, "creating fixture repository: %zu commits, %zu branches\n", options.commits,
+                options.branches);
+        std::string oid = makeCommitRepo(dir.path(), options.commits);
+        addBranches(dir.path(), oid, syntheticBranchNames(options.branches), std::min<size_t>(options.branches, 64));
+
+        for (const char *file : {"menus.json", "help.json"})
+        {
+            std::ifstream source(options.dataDir + "/" + file, std::ios::binary);
+            if (!source)
+                throw std::runtime_error("cannot read " + options.dataDir + "/" + file);
+            std::ofstream(dir.path() + "/" + file, std::ios::binary) << source.rdbuf();
+        }
+        std::ofstream(dir.path() + "/.git/info/exclude", std::ios::app) << "menus.json\nhelp.json\n";
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            std::string value = argv[++i];
+            if (arg == "--binary")
+                options.binary = value;
+            else if (arg == "--data-dir")
+                options.dataDir = value;
+            else if (arg == "--out")
+                options.out = value;
+            else if (arg == "--scenario")
+                options.scenario = value;
+            else if (arg == "--script")
+                options.script = value;
+            else if (arg == "--commits")
+                options.commits = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 10));
+            else if (arg == "--branches")
+                options.branches = strtoull(value.c_str(), nullptr, 10);
+            else if (arg == "--settle")
+                options.settleMs = atoi(value.c_str());
+            else if (arg == "--timeout")
+                options.timeoutMs = atoi(value.c_str());
+            else if (arg == "--max-p99")
+                options.maxP99 = atof(value.c_str());
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--binary PATH] [--data-dir DIR] [--out FILE] [--scenario NAME] "
+                        "[--script FILE] [--commits N] [--branches N] [--settle MS] [--timeout MS] "
+                        "[--max-p99 MS]\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<Scenario> scenarios;
+    if (!options.script.empty())
+    {
+        std::ifstream file(options.script);
+        if (!file)
+        {
+            fprintf(stderr, "replay: cannot read %s\n", options.script.c_str());
+            return 2;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        scenarios.push_back({options.script, text.str()});
+    }
+    for (const Scenario &scenario : builtinScenarios)
+    {
+        if (options.script.empty() && (options.scenario.empty() || options.scenario == scenario.name))
+            scenarios.push_back(scenario);
+    }
+    if (scenarios.empty())
+    {
+        fprintf(stderr, "replay: no scenario named %s\n", options.scenario.c_str());
+        return 2;
+    }
+
+    // Scripted prompts must not end up in the user's own command history
+    setenv("GITNCURSES_HISTORY", "", 1);
+
+    nlohmann::json results = nlohmann::json::array();
+    bool withinLimit = true;
+    try
+    {
+        TempDir dir("replay");
+        prepareFixture(dir, options);
+
+        for (const Scenario &scenario : scenarios)
+        {
+            // Every scenario gets a fresh process, so earlier ones cannot warm its caches
+            PtySession session;
+            session.start(options.binary, dir.path(), options.rows, options.columns);
+            Paint startup = session.drain(300, 10000);
+            if (!startup.painted)
+                throw std::runtime_error(options.binary + " drew nothing; is it the gitNCurses binary?");
+
+            nlohmann::json result = summarize(scenario, replay(session, scenario.script, dir.path(), options), startup.lastByteMs);
+            session.stop();
+
+            double p99 = result["latency_ms"]["p99"].get<double>();
+            if (options.maxP99 > 0 && p99 > options.maxP99)
+            {
+                fprintf(stderr, "%s: p99 %.2f ms exceeds the %.2f ms limit\n", scenario.name.c_str(), p99,
+                        options.maxP99);
+                withinLimit = false;
+            }
+            results.push_back(result);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "replay: %s\n", e.what());
+        return 1;
+    }
+
+    nlohmann::json report = {
+        {"context",
+         {{"binary", options.binary},
+          {"terminal", {{"rows", options.rows}, {"columns", options.columns}, {"type", "xterm-256color"}}},
+          {"fixture", {{"commits", options.commits}, {"branches", options.branches}}},
+          {"settle_ms", options.settleMs},
+          {"timeout_ms", options.timeoutMs}}},
+        {"scenarios", results},
+    };
+    std::string json = report.dump(2) + "\n";
+    if (options.out.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream(options.out) << json;
+        fprintf(stderr, "results written to %s\n", options.out.c_str());
+    }
+    return withinLimit ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+#include "BlameView.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace
+{
+    bool startsWith(std::string_view text, std::string_view prefix)
+    {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // Pad or cut to exactly width characters
+    void appendColumn(std::string &out, std::string_view text, size_t width)
+    {
+        text = text.substr(0, width);
+        out.append(text);
+        out.append(width - text.size(), ' ');
+    }
+}
+
+std::shared_ptr<BlameData> BlameCache::find(const std::string &path, const std::string &blob,
+                                            const std::string &head)
+{
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if ((*it)->path == path && (*it)->blob == blob && (*it)->head == head)
+        {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front();
+        }
+    }
+    return nullptr;
+}
+
+void BlameCache::store(std::shared_ptr<BlameData> data)
+{
+    entries.remove_if([&](const std::shared_ptr<BlameData> &entry)
+                      { return entry->path == data->path; });
+    entries.push_front(std::move(data));
+    if (entries.size() > capacity)
+    {
+        entries.pop_back();
+    }
+}
+
+BlameView::BlameView(const std::string &path, const std::string &blob, const std::string &head, BlameCache &cache)
+    : data(blob.empty() ? nullptr : cache.find(path, blob, head)), cache(cache), cached(data != nullptr),
+      process{-1, -1, -1}, running(false), buffer(64 * 1024), groupCommit(BlameData::kUnblamed), groupLine(0),
+      groupLines(0), renderedFirst(0)
+{
+    if (cached)
+        return;
+
+    data = std::make_shared<BlameData>();
+    data->path = path;
+    data->blob = blob;
+    data->head = head;
+    loadText();
+    start();
+}
+
+BlameView::~BlameView()
+{
+    stop();
+}
+
+void BlameView::loadText()
+{
+    // The worktree file is what git blame annotates, so its lines can be listed before git reports anything
+    std::ifstream file(data->path, std::ios::binary);
+    if (!file)
+    {
+        error = "cannot read " + data->path;
+        return;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    data->text = contents.str();
+
+    size_t pos = 0;
+    while (pos < data->text.size())
+    {
+        data->lineStarts.push_back(static_cast<uint32_t>(pos));
+        size_t newline = data->text.find('\n', pos);
+        pos = newline == std::string::npos ? data->text.size() : newline + 1;
+    }
+    data->lineCommit.assign(data->lineStarts.size(), BlameData::kUnblamed);
+}
+
+void BlameView::start()
+{
+    try
+    {
+        process = ProcessRunner::spawn({"git", "blame", "--incremental", "--", data->path}, true);
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+        return;
+    }
+    fcntl(process.outFd, F_SETFL, fcntl(process.outFd, F_GETFL) | O_NONBLOCK);
+    fcntl(process.errFd, F_SETFL, fcntl(process.errFd, F_GETFL) | O_NONBLOCK);
+    running = true;
+}
+
+void BlameView::stop()
+{
+    if (!running)
+        return;
+    kill(-process.pid, SIGTERM);
+    close(process.outFd);
+    close(process.errFd);
+    ProcessRunner::waitForExit(process.pid);
+    running = false;
+}
+
+bool BlameView::pump()
+{
+    if (!running)
+        return false;
+
+    ssize_t n;
+    while ((n = read(process.errFd, buffer.data(), buffer.size())) > 0)
+    {
+        error.assign(buffer.data(), n);
+    }
+
+    size_t before = data->blamedLines;
+    for (int reads = 0; reads < 16; reads++)
+    {
+        n = read(process.outFd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        Instrumentation::instance().processOutput(process.pid, n);
+
+        const char *p = buffer.data();
+        const char *end = p + n;
+        while (p < end)
+        {
+            const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (!newline)
+            {
+                partial.append(p, end - p);
+                break;
+            }
+            if (partial.empty())
+            {
+                parseLine(std::string_view(p, newline - p));
+            }
+            else
+            {
+                partial.append(p, newline - p);
+                parseLine(partial);
+                partial.clear();
+            }
+            p = newline + 1;
+        }
+    }
+    if (n != 0)
+        return data->blamedLines != before;
+
+    close(process.outFd);
+    close(process.errFd);
+    int exitCode = ProcessRunner::waitForExit(process.pid);
+    running = false;
+    if (exitCode == 0)
+    {
+        data->complete = true;
+        if (!data->blob.empty())
+            cache.store(data);
+    }
+    return true;
+}
+
+void BlameView::parseLine(std::string_view record)
+{
+    if (groupCommit == BlameData::kUnblamed)
+    {
+        // Group header: "<id> <source line> <final line> <line count>"
+        size_t space = record.find(' ');
+        if (space == std::string_view::npos)
+            return;
+        std::string id(record.substr(0, space));
+        unsigned long sourceLine = 0, finalLine = 0, count = 0;
+        if (sscanf(std::string(record.substr(space + 1)).c_str(), "%lu %lu %lu", &sourceLine, &finalLine, &count) != 3 ||
+            finalLine == 0)
+            return;
+
+        auto found = data->commitIndex.find(id);
+        if (found == data->commitIndex.end())
+        {
+            found = data->commitIndex.emplace(id, static_cast<uint32_t>(data->commits.size())).first;
+            data->commits.push_back({id, "", 0});
+        }
+        groupCommit = found->second;
+        groupLine = finalLine - 1;
+        groupLines = count;
+        return;
+    }
+
+    // Metadata follows only the first group of each commit
+    BlameCommit &commit = data->commits[groupCommit];
+    if (startsWith(record, "author "))
+    {
+        commit.author = std::string(record.substr(7));
+    }
+    else if (startsWith(record, "author-time "))
+    {
+        commit.time = strtoll(std::string(record.substr(12)).c_str(), nullptr, 10);
+    }
+    else if (startsWith(record, "filename "))
+    {
+        // Ends the group
+        size_t last = std::min(groupLine + groupLines, data->lineCommit.size());
+        for (size_t i = groupLine; i < last; i++)
+        {
+            if (data->lineCommit[i] == BlameData::kUnblamed)
+                data->blamedLines++;
+            data->lineCommit[i] = groupCommit;
+        }
+        groupCommit = BlameData::kUnblamed;
+    }
+}
+
+std::string BlameView::rowText(size_t index) const
+{
+    if (index >= data->lineStarts.size())
+        return std::string();
+
+    std::string text;
+    uint32_t commitIndex = data->lineCommit[index];
+    if (commitIndex == BlameData::kUnblamed)
+    {
+        text = "........ ............ .......... ";
+    }
+    else
+    {
+        const BlameCommit &commit = data->commits[commitIndex];
+        char date[16] = "";
+        time_t time = static_cast<time_t>(commit.time);
+        struct tm local;
+        if (commit.time && localtime_r(&time, &local))
+            strftime(date, sizeof(date), "%Y-%m-%d", &local);
+        appendColumn(text, commit.id, 8);
+        text += ' ';
+        appendColumn(text, commit.author, 12);
+        text += ' ';
+        appendColumn(text, date, 10);
+        text += ' ';
+    }
+
+    std::string number = std::to_string(index + 1);
+    text.append(number.size() < 5 ? 5 - number.size() : 0, ' ');
+    text += number + " | ";
+
+    size_t start = data->lineStarts[index];
+    size_t end = index + 1 < data->lineStarts.size() ? data->lineStarts[index + 1] : data->text.size();
+    if (end > start && data->text[end - 1] == '\n')
+        end--;
+    text.append(data->text, start, end - start);
+    return text;
+}
+
+std::string BlameView::title() const
+{
+    std::string text = "blame " + data->path;
+    if (cached)
+    {
+        text += " (cached)";
+    }
+    else if (!data->complete)
+    {
+        size_t total = std::max<size_t>(data->lineStarts.size(), 1);
+        text += " - " + std::to_string(data->blamedLines * 100 / total) + "%";
+    }
+    text += " - " + std::to_string(data->commits.size()) + " commits";
+    if (!error.empty())
+        text += " - " + error.substr(0, error.find('\n'));
+    return text;
+}
+
+void BlameView::prepare(size_t first, size_t count)
+{
+    renderedFirst = first;
+    rendered.clear();
+    for (size_t i = first; i < first + count && i < data->lineStarts.size(); i++)
+    {
+        rendered.push_back(rowText(i));
+    }
+}
+
+std::string_view BlameView::line(size_t index) const
+{
+    if (index >= renderedFirst && index - renderedFirst < rendered.size())
+        return rendered[index - renderedFirst];
+    scratch = rowText(index);
+    return scratch;
+}
+
+PaneView::LineStyle BlameView::lineStyle(size_t index) const
+{
+    // Lines git has not reached yet stand out until their commit is known
+    if (index < data->lineCommit.size() && data->lineCommit[index] == BlameData::kUnblamed)
+        return LineStyle::Note;
+    return LineStyle::Plain;
+}
@@ -0,0 +1,100 @@
+#ifndef BLAME_VIEW_H
+#define BLAME_VIEW_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PaneView.h"
+#include "ProcessRunner.h"
+
+// Commit metadata, stored once per commit however many lines it owns
+struct BlameCommit
+{
+    std::string id;
+    std::string author;
+    int64_t time;
+};
+
+// Blame of one version of a file: its text plus the commit of every line
+struct BlameData
+{
+    std::string path;
+    std::string blob;                  // Object id of the blamed content
+    std::string head;                  // Commit HEAD pointed at; a commit changes the blame of the same content
+    std::string text;                  // File contents
+    std::vector<uint32_t> lineStarts;  // Offset of each line in text
+    std::vector<BlameCommit> commits;
+    std::unordered_map<std::string, uint32_t> commitIndex;
+    std::vector<uint32_t> lineCommit;  // Index into commits, kUnblamed until git reports the line
+    size_t blamedLines = 0;
+    bool complete = false;
+
+    static constexpr uint32_t kUnblamed = UINT32_MAX;
+};
+
+// Finished blames keyed by (path, blob id, HEAD commit); a file that has not changed
+// since the last blame, with no commit in between, reopens without running git
+class BlameCache
+{
+public:
+    explicit BlameCache(size_t capacity = 16) : capacity(capacity) {}
+
+    std::shared_ptr<BlameData> find(const std::string &path, const std::string &blob, const std::string &head);
+    void store(std::shared_ptr<BlameData> data);
+
+private:
+    size_t capacity;
+    std::list<std::shared_ptr<BlameData>> entries; // Most recently used first
+};
+
+// `git blame --incremental` shown as it runs: every line of the file is
+// listed at once and its commit column fills in as git reports the groups.
+class BlameView : public PaneView
+{
+public:
+    // blob is the id of the file's current content and head the current commit, the cache key
+    BlameView(const std::string &path, const std::string &blob, const std::string &head, BlameCache &cache);
+    ~BlameView() override;
+
+    BlameView(const BlameView &) = delete;
+    BlameView &operator=(const BlameView &) = delete;
+
+    std::string title() const override;
+    size_t lineCount() const override { return data->lineStarts.size(); }
+    std::string_view line(size_t index) const override;
+    LineStyle lineStyle(size_t index) const override;
+    void prepare(size_t first, size_t count) override;
+    int fd() const override { return running ? process.outFd : -1; }
+    bool pump() override;
+
+private:
+    std::shared_ptr<BlameData> data;
+    BlameCache &cache;
+    bool cached; // Served from the cache without running git
+
+    SpawnedProcess process;
+    bool running;
+    std::string error;
+    std::vector<char> buffer;
+    std::string partial; // Bytes of a record line whose newline has not arrived yet
+
+    // Group being parsed: "<id> <orig> <final> <count>" up to its "filename" line
+    uint32_t groupCommit;
+    size_t groupLine;
+    size_t groupLines;
+
+    size_t renderedFirst;
+    std::vector<std::string> rendered;
+    mutable std::string scratch;
+
+    void start();
+    void stop();
+    void loadText();
+    void parseLine(std::string_view record);
+    std::string rowText(size_t index) const;
+};
+
+#endif // BLAME_VIEW_H
@@ -0,0 +1,78 @@
+#include "BranchSet.h"
+#include <algorithm>
+
+bool BranchSet::assign(const std::vector<std::string> &branches)
+{
+    if (branches.size() == names.size() &&
+        std::all_of(branches.begin(), branches.end(), [this](const std::string &name)
+                    { return contains(name); }))
+        return false;
+
+    names.clear();
+    sorted.clear();
+    names.reserve(branches.size());
+    sorted.reserve(branches.size());
+    for (const auto &name : branches)
+    {
+        auto inserted = names.insert(name);
+        if (inserted.second)
+        {
+            sorted.push_back(*inserted.first);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return true;
+}
+
+bool BranchSet::insert(const std::string &name)
+{
+    auto inserted = names.insert(name);
+    if (!inserted.second)
+        return false;
+    std::string_view view = *inserted.first;
+    sorted.insert(std::lower_bound(sorted.begin(), sorted.end(), view), view);
+    return true;
+}
+
+bool BranchSet::erase(const std::string &name)
+{
+    auto it = names.find(name);
+    if (it == names.end())
+        return false;
+    // Drop the view before the string it points at
+    auto pos = std::lower_bound(sorted.begin(), sorted.end(), std::string_view(*it));
+    sorted.erase(pos);
+    names.erase(it);
+    return true;
+}
+
+std::vector<std::string> BranchSet::list() const
+{
+    return std::vector<std::string>(sorted.begin(), sorted.end());
+}
+
+std::vector<std::string> BranchSet::withPrefix(std::string_view prefix, size_t limit) const
+{
+    std::vector<std::string> result;
+    for (auto it = std::lower_bound(sorted.begin(), sorted.end(), prefix);
+         it != sorted.end() && result.size() < limit && it->compare(0, prefix.size(), prefix) == 0; ++it)
+    {
+        result.emplace_back(*it);
+    }
+    return result;
+}
+
+std::string BranchSet::commonPrefix(std::string_view prefix) const
+{
+    // In sorted order whatever the first and last match share, every match in between shares too
+    auto first = std::lower_bound(sorted.begin(), sorted.end(), prefix);
+    if (first == sorted.end() || first->compare(0, prefix.size(), prefix) != 0)
+        return std::string(prefix);
+    auto end = std::partition_point(first, sorted.end(), [&](std::string_view name)
+                                    { return name.compare(0, prefix.size(), prefix) == 0; });
+    std::string_view last = *(end - 1);
+    size_t common = prefix.size();
+    while (common < first->size() && common < last.size() && (*first)[common] == last[common])
+        common++;
+    return std::string(first->substr(0, common));
+}
@@ -0,0 +1,39 @@
+#ifndef BRANCH_SET_H
+#define BRANCH_SET_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Local branch names, each stored once. Membership is a hash lookup and a
+// sorted view over the same strings answers prefix queries, so both stay
+// cheap with thousands of branches and single names can be added or removed
+// as ref change events arrive.
+class BranchSet
+{
+public:
+    // Replace the whole set; returns true if anything changed
+    bool assign(const std::vector<std::string> &branches);
+    bool insert(const std::string &name);
+    bool erase(const std::string &name);
+
+    bool contains(const std::string &name) const { return names.count(name) != 0; }
+    size_t size() const { return names.size(); }
+
+    // All names in sorted order
+    std::vector<std::string> list() const;
+
+    // Sorted names starting with prefix, at most limit of them
+    std::vector<std::string> withPrefix(std::string_view prefix, size_t limit = SIZE_MAX) const;
+
+    // Longest string every name starting with prefix starts with; prefix itself when none does
+    std::string commonPrefix(std::string_view prefix) const;
+
+private:
+    std::unordered_set<std::string> names; // Owns the strings; nodes never move, so views stay valid
+    std::vector<std::string_view> sorted;  // Views into names
+};
+
+#endif // BRANCH_SET_H
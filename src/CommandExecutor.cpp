@@ -0,0 +1,113 @@
+#include "CommandExecutor.h"
+#include "Instrumentation.h"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+CommandExecutor::CommandExecutor(size_t bufferSize)
+    : buffer(bufferSize), pid(-1), fds{-1, -1}, running(false), cancelled(false), lastExitCode(0)
+{
+}
+
+CommandExecutor::~CommandExecutor()
+{
+    if (running)
+    {
+        cancel();
+        finish();
+    }
+}
+
+void CommandExecutor::start(const std::vector<std::string> &argv)
+{
+    if (running)
+    {
+        throw std::runtime_error("A command is already running");
+    }
+
+    SpawnedProcess process = ProcessRunner::spawn(argv, true);
+    pid = process.pid;
+    fds[0] = process.outFd;
+    fds[1] = process.errFd;
+    for (int fd : fds)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    running = true;
+    cancelled = false;
+    lastExitCode = 0;
+}
+
+bool CommandExecutor::pump(const OutputCallback &onOutput)
+{
+    if (!running)
+        return false;
+
+    // Bound the reads per call so a fast producer cannot starve the UI loop
+    for (int &fd : fds)
+    {
+        for (int reads = 0; fd >= 0 && reads < 16; reads++)
+        {
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n > 0)
+            {
+                Instrumentation::instance().processOutput(pid, n);
+                onOutput(buffer.data(), n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+
+            // EOF or a hard error: this stream is done
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fds[0] < 0 && fds[1] < 0)
+    {
+        finish();
+        return true;
+    }
+    return false;
+}
+
+std::vector<int> CommandExecutor::openFds() const
+{
+    std::vector<int> open;
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+            open.push_back(fd);
+    }
+    return open;
+}
+
+void CommandExecutor::cancel()
+{
+    if (running && !cancelled)
+    {
+        kill(-pid, SIGTERM);
+        cancelled = true;
+    }
+}
+
+void CommandExecutor::finish()
+{
+    for (int &fd : fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    lastExitCode = ProcessRunner::waitForExit(pid);
+    pid = -1;
+    running = false;
+}
@@ -0,0 +1,49 @@
+#ifndef COMMAND_EXECUTOR_H
+#define COMMAND_EXECUTOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "ProcessRunner.h"
+
+// Runs one child process in the background over non-blocking pipes.
+// The UI calls pump() from its event loop to collect output as it arrives.
+class CommandExecutor
+{
+public:
+    using OutputCallback = std::function<void(const char *data, size_t size)>;
+
+    explicit CommandExecutor(size_t bufferSize = 64 * 1024);
+    ~CommandExecutor();
+
+    CommandExecutor(const CommandExecutor &) = delete;
+    CommandExecutor &operator=(const CommandExecutor &) = delete;
+
+    // Start argv in its own process group; throws if one is already running or spawn fails
+    void start(const std::vector<std::string> &argv);
+
+    // Drain whatever output is available without blocking; returns true once the child has exited
+    bool pump(const OutputCallback &onOutput);
+
+    // Terminate the child and everything it spawned
+    void cancel();
+
+    // Pipes still open, for registering with an event loop; changes as streams reach EOF
+    std::vector<int> openFds() const;
+
+    bool isRunning() const { return running; }
+    bool wasCancelled() const { return cancelled; }
+    int exitCode() const { return lastExitCode; }
+
+private:
+    std::vector<char> buffer;
+    pid_t pid;
+    int fds[2]; // stdout, stderr; -1 once closed
+    bool running;
+    bool cancelled;
+    int lastExitCode;
+
+    void finish();
+};
+
+#endif // COMMAND_EXECUTOR_H
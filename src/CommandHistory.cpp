@@ -0,0 +1,167 @@
+#include "CommandHistory.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    uint32_t trigramAt(std::string_view text, size_t i)
+    {
+        return static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+               static_cast<unsigned char>(text[i + 2]);
+    }
+}
+
+CommandHistory::CommandHistory()
+    : fd(-1), mapped(nullptr), mappedLength(0), split(false), indexed(false)
+{
+}
+
+CommandHistory::~CommandHistory()
+{
+    if (mapped)
+        munmap(const_cast<char *>(mapped), mappedLength);
+    if (fd >= 0)
+        close(fd);
+}
+
+bool CommandHistory::open(const std::string &path)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        // Private and read-only: later appends, ours or another session's, never move what we see
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mapped = static_cast<const char *>(data);
+            mappedLength = st.st_size;
+        }
+    }
+    return true;
+}
+
+void CommandHistory::splitEntries()
+{
+    if (split)
+        return;
+    split = true;
+
+    const char *p = mapped;
+    const char *end = mapped + mappedLength;
+    while (p < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *lineEnd = newline ? newline : end;
+        if (lineEnd > p)
+            entries.emplace_back(p, lineEnd - p);
+        p = lineEnd + 1;
+    }
+    // Commands added before the first lookup go after the file's
+    for (const std::string &command : added)
+    {
+        entries.emplace_back(command);
+    }
+}
+
+void CommandHistory::add(const std::string &command)
+{
+    if (command.empty() || command.find('\n') != std::string::npos)
+        return;
+    splitEntries();
+    if (!entries.empty() && entries.back() == command)
+        return;
+
+    added.push_back(command);
+    entries.emplace_back(added.back());
+    if (indexed)
+        indexEntry(entries.size() - 1);
+
+    if (fd >= 0)
+    {
+        // One write per entry: with O_APPEND, concurrent sessions never interleave within a line
+        std::string line = command + "\n";
+        ssize_t ignored = write(fd, line.data(), line.size());
+        (void)ignored;
+    }
+}
+
+size_t CommandHistory::size()
+{
+    splitEntries();
+    return entries.size();
+}
+
+std::string_view CommandHistory::entry(size_t index)
+{
+    splitEntries();
+    return index < entries.size() ? entries[index] : std::string_view();
+}
+
+void CommandHistory::indexEntry(size_t index)
+{
+    std::string_view text = entries[index];
+    for (size_t i = 0; i + 3 <= text.size(); i++)
+    {
+        std::vector<uint32_t> &postings = trigrams[trigramAt(text, i)];
+        // A trigram repeated within one entry is listed once
+        if (postings.empty() || postings.back() != index)
+            postings.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+size_t CommandHistory::searchBackward(std::string_view text, size_t before)
+{
+    splitEntries();
+    before = std::min(before, entries.size());
+    if (text.empty())
+        return npos;
+
+    // Too short for a trigram: scan, which is fast enough for a query this unselective
+    if (text.size() < 3)
+    {
+        for (size_t i = before; i-- > 0;)
+        {
+            if (entries[i].find(text) != std::string_view::npos)
+                return i;
+        }
+        return npos;
+    }
+
+    if (!indexed)
+    {
+        indexed = true;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            indexEntry(i);
+        }
+    }
+
+    // Every match contains every trigram of the query, so walking the shortest list finds them all
+    const std::vector<uint32_t> *rarest = nullptr;
+    for (size_t i = 0; i + 3 <= text.size(); i++)
+    {
+        auto it = trigrams.find(trigramAt(text, i));
+        if (it == trigrams.end())
+            return npos;
+        if (!rarest || it->second.size() < rarest->size())
+            rarest = &it->second;
+    }
+
+    auto it = std::lower_bound(rarest->begin(), rarest->end(), before);
+    while (it != rarest->begin())
+    {
+        --it;
+        if (entries[*it].find(text) != std::string_view::npos)
+            return *it;
+    }
+    return npos;
+}
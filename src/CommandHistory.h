@@ -0,0 +1,55 @@
+#ifndef COMMAND_HISTORY_H
+#define COMMAND_HISTORY_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Commands typed at the git> prompt, one per line in an append-only file that
+// every session adds to. The file is mapped rather than read, so startup costs
+// the same with ten entries or a hundred thousand; it is split into lines the
+// first time an entry is needed. Reverse search goes through a trigram index,
+// also built on first use and then extended as commands are added, so each
+// keystroke only checks entries that contain the rarest trigram of the query.
+class CommandHistory
+{
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    CommandHistory();
+    ~CommandHistory();
+
+    CommandHistory(const CommandHistory &) = delete;
+    CommandHistory &operator=(const CommandHistory &) = delete;
+
+    // Map the history file, creating it if needed; without one the history lasts for this session only
+    bool open(const std::string &path);
+
+    // Record a command; a repeat of the newest entry is not stored again
+    void add(const std::string &command);
+
+    // Entries oldest first
+    size_t size();
+    std::string_view entry(size_t index);
+
+    // Newest entry before index `before` that contains text; npos when there is none
+    size_t searchBackward(std::string_view text, size_t before);
+
+private:
+    int fd;               // Opened for appending
+    const char *mapped;   // File contents at open(), nullptr when empty
+    size_t mappedLength;
+    bool split;           // entries covers the mapped lines
+    std::vector<std::string_view> entries; // Views into the mapping or into added
+    std::deque<std::string> added;         // This session's commands; a deque keeps the views valid
+    bool indexed;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams; // Ascending entry numbers per trigram
+
+    void splitEntries();
+    void indexEntry(size_t index);
+};
+
+#endif // COMMAND_HISTORY_H
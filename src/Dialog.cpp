@@ -1,7 +1,9 @@
 #include "Dialog.h"
+#include "ScreenRenderer.h"
 
-Dialog::Dialog(int width, int height)
-    : dialogWidth(width), dialogHeight(height), dialogWin(nullptr), inputWin(nullptr)
+Dialog::Dialog(ScreenRenderer &renderer, KeyReader readKey, int width, int height)
+    : renderer(renderer), readKey(std::move(readKey)), dialogWidth(width), dialogHeight(height),
+      dialogWin(nullptr), inputWin(nullptr)
 {
 }
 
@@ -26,13 +28,11 @@ Dialog::DialogResult Dialog::show(const std::string &title,
     // Create dialog window
     dialogWin = newwin(dialogHeight, dialogWidth, startY, startX);
     box(dialogWin, 0, 0);
-    keypad(dialogWin, TRUE);
 
     // Create input field with box
     inputWin = derwin(dialogWin, 3, dialogWidth - 4, 3, 2);
     box(inputWin, 0, 0);
-    wrefresh(dialogWin);
-    wrefresh(inputWin);
+    renderer.showOverlay(dialogWin);
 
     // Input handling
     std::string input = defaultValue;
@@ -45,7 +45,7 @@ Dialog::DialogResult Dialog::show(const std::string &title,
     {
         drawDialog(title, prompt, input, cursorPos, selectedItem);
 
-        int ch = wgetch(dialogWin);
+        int ch = readKey();
         switch (ch)
         {
         case '\t': // Tab key
@@ -87,11 +87,11 @@ Dialog::DialogResult Dialog::show(const std::string &title,
     }
 
     // Clean up
+    renderer.hideOverlay(dialogWin);
     delwin(inputWin);
     delwin(dialogWin);
     inputWin = nullptr;
     dialogWin = nullptr;
-    refresh();
 
     return {confirmed, input};
 }
@@ -124,8 +124,6 @@ void Dialog::drawDialog(const std::string &title,
         wattroff(inputWin, A_DIM);
     }
     mvwprintw(inputWin, 1, 1, "%s", input.c_str());
-    wmove(inputWin, 1, cursorPos + 1);
-    wrefresh(inputWin);
 
     // Draw buttons with appropriate highlighting
     for (int i = 0; i < 2; i++)
@@ -141,5 +139,7 @@ void Dialog::drawDialog(const std::string &title,
             mvwprintw(dialogWin, 5, 15 + (i * 20), "[ %s ]", i == 0 ? "OK" : "Cancel");
         }
     }
-    wrefresh(dialogWin);
+    // The input field is a subwindow: its cells only reach the panel once the parent is touched
+    touchwin(dialogWin);
+    renderer.markDirty(dialogWin);
 }
\ No newline at end of file
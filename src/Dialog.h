@@ -1,19 +1,26 @@
 #ifndef DIALOG_H
 #define DIALOG_H
 
+#include <functional>
 #include <ncurses.h>
 #include <string>
 
+class ScreenRenderer;
+
+// Modal text prompt drawn as a popup panel. Keys come from readKey, so the
+// owner's event loop keeps running (and repainting) while the dialog is open.
 class Dialog
 {
 public:
+    using KeyReader = std::function<int()>;
+
     struct DialogResult
     {
         bool confirmed;
         std::string input;
     };
 
-    Dialog(int width = 60, int height = 7);
+    Dialog(ScreenRenderer &renderer, KeyReader readKey, int width = 60, int height = 7);
     ~Dialog();
 
     // Show a dialog with a title, prompt, and optional default value
@@ -22,6 +29,8 @@ public:
                       const std::string &defaultValue = "");
 
 private:
+    ScreenRenderer &renderer;
+    KeyReader readKey;
     int dialogWidth;
     int dialogHeight;
     WINDOW *dialogWin;
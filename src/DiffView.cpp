@@ -0,0 +1,469 @@
+#include "DiffView.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    const uint64_t kCheckpointLines = 64;         // Rows are found by scanning at most this many lines
+    const size_t kHeadBytes = 4096;               // Enough of a line to classify it and take a path from it
+    const size_t kMaxLineBytes = 4096;            // Longer lines are cut for display
+    const size_t kChunkBytes = 256 * 1024;        // Read-back window
+    const uint64_t kCollapseLines = 5000;         // Files with a bigger diff start collapsed
+    const uint64_t kCollapseBytes = 1024 * 1024;
+
+    bool startsWith(const std::string &text, const char *prefix)
+    {
+        return text.compare(0, strlen(prefix), prefix) == 0;
+    }
+
+    // "diff --git a/x b/x" or "diff --cc x"
+    std::string pathOf(const std::string &header)
+    {
+        size_t pos = header.rfind(" b/");
+        if (pos != std::string::npos)
+            return header.substr(pos + 3);
+        pos = header.find(' ', strlen("diff --"));
+        return pos == std::string::npos ? header : header.substr(pos + 1);
+    }
+
+    std::string formatBytes(uint64_t bytes)
+    {
+        if (bytes >= 1024 * 1024)
+            return std::to_string(bytes / (1024 * 1024)) + " MiB";
+        if (bytes >= 1024)
+            return std::to_string(bytes / 1024) + " KiB";
+        return std::to_string(bytes) + " bytes";
+    }
+}
+
+DiffView::DiffView(const std::vector<std::string> &args)
+    : process{-1, -1, -1}, running(false), buffer(64 * 1024), spillFd(-1), spillBytes(0), rawLines(0),
+      checkpoints{0}, lineStart(0), lineBytes(0), totalRows(0), renderedFirst(0), chunkOffset(0)
+{
+    std::vector<std::string> argv = {"git"};
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        argv.push_back(args[i]);
+        command += (i ? " " : "") + args[i];
+        if (i == 0)
+        {
+            // Plain text for indexing; colour is applied per visible row
+            argv.push_back("--no-color");
+            argv.push_back("--no-ext-diff");
+        }
+    }
+
+    const char *tmp = getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/gitncurses-diff-XXXXXX";
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    spillFd = mkostemp(name.data(), O_CLOEXEC);
+    if (spillFd < 0)
+    {
+        error = std::string("cannot create temporary file: ") + strerror(errno);
+        return;
+    }
+    // Nothing else needs the name; the space is freed when the view closes
+    unlink(name.data());
+
+    try
+    {
+        process = ProcessRunner::spawn(argv, true);
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+        return;
+    }
+    fcntl(process.outFd, F_SETFL, fcntl(process.outFd, F_GETFL) | O_NONBLOCK);
+    fcntl(process.errFd, F_SETFL, fcntl(process.errFd, F_GETFL) | O_NONBLOCK);
+    running = true;
+}
+
+DiffView::~DiffView()
+{
+    stop();
+    if (spillFd >= 0)
+        close(spillFd);
+}
+
+void DiffView::stop()
+{
+    if (!running)
+        return;
+    kill(-process.pid, SIGTERM);
+    close(process.outFd);
+    close(process.errFd);
+    ProcessRunner::waitForExit(process.pid);
+    running = false;
+}
+
+bool DiffView::pump()
+{
+    if (!running)
+        return false;
+
+    ssize_t n;
+    while ((n = read(process.errFd, buffer.data(), buffer.size())) > 0)
+    {
+        error.assign(buffer.data(), n);
+    }
+
+    uint64_t before = totalRows;
+    for (int reads = 0; reads < 16; reads++)
+    {
+        n = read(process.outFd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        Instrumentation::instance().processOutput(process.pid, n);
+        consume(buffer.data(), n);
+        if (!running)
+            return true; // The spill file could not be written
+    }
+    if (n == 0)
+    {
+        // A last line without a newline still counts
+        if (lineBytes > 0)
+            endLine();
+        stop();
+        return true;
+    }
+    return totalRows != before;
+}
+
+void DiffView::consume(const char *data, size_t size)
+{
+    for (size_t written = 0; written < size;)
+    {
+        ssize_t n = pwrite(spillFd, data + written, size - written, spillBytes + written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            error = std::string("cannot write temporary file: ") + strerror(errno);
+            stop();
+            return;
+        }
+        written += n;
+    }
+    spillBytes += size;
+
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+        size_t length = (newline ? newline : end) - data;
+        if (lineHead.size() < kHeadBytes)
+            lineHead.append(data, std::min(length, kHeadBytes - lineHead.size()));
+        lineBytes += length;
+        if (!newline)
+            break;
+        lineBytes++;
+        endLine();
+        data = newline + 1;
+    }
+}
+
+void DiffView::endLine()
+{
+    uint64_t line = rawLines;
+    bool header = startsWith(lineHead, "diff --");
+    if (header || files.empty())
+    {
+        // Output before the first header (warnings) becomes a file without a path, which never collapses
+        files.push_back({line, 0, 0, hunkLines.size(), header ? pathOf(lineHead) : "", false, false});
+        fileRows.push_back(totalRows);
+    }
+    else if (startsWith(lineHead, "@@"))
+    {
+        hunkLines.push_back(line);
+    }
+
+    DiffFile &file = files.back();
+    file.lines++;
+    file.bytes += lineBytes;
+    if (!file.collapsed && !file.toggled && !file.path.empty() &&
+        (file.lines > kCollapseLines || file.bytes > kCollapseBytes))
+    {
+        file.collapsed = true;
+    }
+    totalRows = fileRows.back() + shownRows(file);
+
+    rawLines++;
+    lineStart += lineBytes;
+    lineBytes = 0;
+    lineHead.clear();
+    if (rawLines % kCheckpointLines == 0)
+    {
+        checkpoints.push_back(lineStart);
+    }
+}
+
+void DiffView::updateRows(size_t fromFile)
+{
+    for (size_t i = std::max<size_t>(fromFile, 1); i < files.size(); i++)
+    {
+        fileRows[i] = fileRows[i - 1] + shownRows(files[i - 1]);
+    }
+    totalRows = files.empty() ? 0 : fileRows.back() + shownRows(files.back());
+}
+
+size_t DiffView::fileOfRow(uint64_t row) const
+{
+    return std::upper_bound(fileRows.begin(), fileRows.end(), row) - fileRows.begin() - 1;
+}
+
+size_t DiffView::fileOfLine(uint64_t raw) const
+{
+    auto it = std::upper_bound(files.begin(), files.end(), raw,
+                               [](uint64_t line, const DiffFile &file)
+                               { return line < file.firstLine; });
+    return it - files.begin() - 1;
+}
+
+uint64_t DiffView::rowOfLine(uint64_t raw) const
+{
+    size_t f = fileOfLine(raw);
+    return files[f].collapsed ? fileRows[f] : fileRows[f] + (raw - files[f].firstLine);
+}
+
+uint64_t DiffView::lineOfRow(uint64_t row, size_t file) const
+{
+    return files[file].firstLine + (row - fileRows[file]);
+}
+
+const char *DiffView::readAt(uint64_t offset, size_t &available) const
+{
+    available = 0;
+    if (offset >= spillBytes)
+        return nullptr;
+    if (offset < chunkOffset || offset >= chunkOffset + chunk.size())
+    {
+        // Only bytes already written are read, and those never change
+        chunk.resize(std::min<uint64_t>(kChunkBytes, spillBytes - offset));
+        ssize_t n = pread(spillFd, chunk.data(), chunk.size(), offset);
+        chunk.resize(n > 0 ? n : 0);
+        chunkOffset = offset;
+        if (chunk.empty())
+            return nullptr;
+    }
+    available = chunk.size() - (offset - chunkOffset);
+    return chunk.data() + (offset - chunkOffset);
+}
+
+std::string DiffView::readLine(uint64_t raw) const
+{
+    // Start at the nearest checkpoint and skip the lines in between
+    uint64_t offset = checkpoints[raw / kCheckpointLines];
+    uint64_t skip = raw % kCheckpointLines;
+    size_t available;
+    while (skip > 0)
+    {
+        const char *data = readAt(offset, available);
+        if (!data)
+            return std::string();
+        const char *newline = static_cast<const char *>(memchr(data, '\n', available));
+        if (!newline)
+        {
+            offset += available;
+            continue;
+        }
+        offset += newline - data + 1;
+        skip--;
+    }
+
+    std::string text;
+    while (text.size() < kMaxLineBytes)
+    {
+        const char *data = readAt(offset, available);
+        if (!data)
+            break;
+        available = std::min(available, kMaxLineBytes - text.size());
+        const char *newline = static_cast<const char *>(memchr(data, '\n', available));
+        if (newline)
+        {
+            text.append(data, newline - data);
+            break;
+        }
+        text.append(data, available);
+        offset += available;
+    }
+    return text;
+}
+
+std::string DiffView::rowText(uint64_t row) const
+{
+    if (row >= totalRows)
+        return std::string();
+    size_t f = fileOfRow(row);
+    const DiffFile &file = files[f];
+    std::string text = readLine(lineOfRow(row, f));
+    if (file.collapsed)
+    {
+        text += "  [" + std::to_string(file.lines - 1) + " lines, " + formatBytes(file.bytes) + " collapsed, o to expand]";
+    }
+    return text;
+}
+
+PaneView::LineStyle DiffView::styleOf(uint64_t row, std::string_view text) const
+{
+    if (row >= totalRows)
+        return LineStyle::Plain;
+    size_t f = fileOfRow(row);
+    const DiffFile &file = files[f];
+    if (file.path.empty())
+        return LineStyle::Note;
+
+    // Everything from "diff --git" to the first hunk is header, including the ---/+++ lines
+    uint64_t raw = lineOfRow(row, f);
+    uint64_t end = file.firstLine + file.lines;
+    uint64_t body = file.firstHunk < hunkLines.size() && hunkLines[file.firstHunk] < end ? hunkLines[file.firstHunk] : end;
+    if (raw < body)
+        return LineStyle::Header;
+
+    switch (text.empty() ? ' ' : text[0])
+    {
+    case '@':
+        return LineStyle::Hunk;
+    case '+':
+        return LineStyle::Added;
+    case '-':
+        return LineStyle::Removed;
+    case '\\':
+        return LineStyle::Note;
+    default:
+        return LineStyle::Plain;
+    }
+}
+
+std::string DiffView::title() const
+{
+    size_t fileCount = files.size() - (!files.empty() && files.front().path.empty() ? 1 : 0);
+    std::string text = command + " - " + std::to_string(fileCount) + " files, " + std::to_string(hunkLines.size()) + " hunks";
+    if (running)
+        text += " (loading " + formatBytes(spillBytes) + ")";
+    text += " - [ ]: hunk, { }: file, o: expand";
+    if (!error.empty())
+        text += " - " + error.substr(0, error.find('\n'));
+    return text;
+}
+
+void DiffView::prepare(size_t first, size_t count)
+{
+    // Only the rows about to be drawn are read back and coloured
+    renderedFirst = first;
+    rendered.clear();
+    renderedStyles.clear();
+    for (size_t row = first; row < first + count && row < totalRows; row++)
+    {
+        rendered.push_back(rowText(row));
+        renderedStyles.push_back(styleOf(row, rendered.back()));
+    }
+}
+
+std::string_view DiffView::line(size_t index) const
+{
+    if (index >= renderedFirst && index - renderedFirst < rendered.size())
+        return rendered[index - renderedFirst];
+    scratch = rowText(index);
+    return scratch;
+}
+
+PaneView::LineStyle DiffView::lineStyle(size_t index) const
+{
+    if (index >= renderedFirst && index - renderedFirst < renderedStyles.size())
+        return renderedStyles[index - renderedFirst];
+    return styleOf(index, rowText(index));
+}
+
+bool DiffView::nextHunk(size_t &cursor) const
+{
+    size_t f = fileOfRow(cursor);
+    auto it = std::upper_bound(hunkLines.begin(), hunkLines.end(), lineOfRow(cursor, f));
+    while (it != hunkLines.end())
+    {
+        size_t hunkFile = fileOfLine(*it);
+        if (!files[hunkFile].collapsed)
+        {
+            cursor = rowOfLine(*it);
+            return true;
+        }
+        // A collapsed file is one stop, at its header
+        if (fileRows[hunkFile] > cursor)
+        {
+            cursor = fileRows[hunkFile];
+            return true;
+        }
+        it = hunkFile + 1 < files.size() ? hunkLines.begin() + files[hunkFile + 1].firstHunk : hunkLines.end();
+    }
+    return false;
+}
+
+bool DiffView::previousHunk(size_t &cursor) const
+{
+    size_t f = fileOfRow(cursor);
+    auto it = std::lower_bound(hunkLines.begin(), hunkLines.end(), lineOfRow(cursor, f));
+    while (it != hunkLines.begin())
+    {
+        --it;
+        size_t hunkFile = fileOfLine(*it);
+        if (!files[hunkFile].collapsed)
+        {
+            cursor = rowOfLine(*it);
+            return true;
+        }
+        if (fileRows[hunkFile] < cursor)
+        {
+            cursor = fileRows[hunkFile];
+            return true;
+        }
+        it = hunkLines.begin() + files[hunkFile].firstHunk;
+    }
+    return false;
+}
+
+bool DiffView::handleKey(int ch, size_t &cursor)
+{
+    if (files.empty() || cursor >= totalRows)
+        return ch == ']' || ch == '[' || ch == '}' || ch == '{' || ch == 'o';
+
+    size_t f = fileOfRow(cursor);
+    switch (ch)
+    {
+    case ']':
+        nextHunk(cursor);
+        return true;
+    case '[':
+        previousHunk(cursor);
+        return true;
+    case '}':
+        if (f + 1 < files.size())
+            cursor = fileRows[f + 1];
+        return true;
+    case '{':
+        if (cursor > fileRows[f])
+            cursor = fileRows[f];
+        else if (f > 0)
+            cursor = fileRows[f - 1];
+        return true;
+    case 'o':
+        if (!files[f].path.empty())
+        {
+            files[f].collapsed = !files[f].collapsed;
+            files[f].toggled = true;
+            updateRows(f);
+            cursor = fileRows[f];
+        }
+        return true;
+    default:
+        return false;
+    }
+}
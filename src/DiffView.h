@@ -0,0 +1,98 @@
+#ifndef DIFF_VIEW_H
+#define DIFF_VIEW_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PaneView.h"
+#include "ProcessRunner.h"
+
+// `git diff` streamed into an unlinked temporary file while file and hunk
+// boundaries are indexed as the bytes arrive. Only the index stays in memory;
+// the rows on screen are read back from the file and coloured when shown.
+// Files with very large diffs start collapsed to their header row.
+class DiffView : public PaneView
+{
+public:
+    // args follow "git", e.g. {"diff"} or {"diff", "--staged"}
+    explicit DiffView(const std::vector<std::string> &args);
+    ~DiffView() override;
+
+    DiffView(const DiffView &) = delete;
+    DiffView &operator=(const DiffView &) = delete;
+
+    std::string title() const override;
+    size_t lineCount() const override { return totalRows; }
+    std::string_view line(size_t index) const override;
+    LineStyle lineStyle(size_t index) const override;
+    void prepare(size_t first, size_t count) override;
+    int fd() const override { return running ? process.outFd : -1; }
+    bool pump() override;
+
+    bool hasCursor() const override { return true; }
+    bool handleKey(int ch, size_t &cursor) override;
+
+private:
+    struct DiffFile
+    {
+        uint64_t firstLine; // Raw line of "diff --git"
+        uint64_t lines;     // Raw lines including the header
+        uint64_t bytes;
+        size_t firstHunk;   // Index into hunkLines
+        std::string path;
+        bool collapsed;
+        bool toggled; // The user expanded or collapsed it; size no longer decides
+    };
+
+    std::string command;
+    SpawnedProcess process;
+    bool running;
+    std::string error;
+    std::vector<char> buffer;
+
+    // Spill file holding the raw diff
+    int spillFd;
+    uint64_t spillBytes;
+
+    // Index of the raw output
+    uint64_t rawLines;                 // Complete lines so far
+    std::vector<uint64_t> checkpoints; // Byte offset of every kCheckpointLines-th line
+    std::string lineHead;              // Start of the line being received, enough to classify it
+    uint64_t lineStart;                // Spill offset where that line starts
+    uint64_t lineBytes;                // Bytes of that line so far
+    std::vector<DiffFile> files;
+    std::vector<uint64_t> hunkLines; // Raw line of every "@@" header
+    std::vector<uint64_t> fileRows;  // Display row of each file's first row
+    uint64_t totalRows;
+
+    // Rows last passed to prepare(), with their colouring
+    size_t renderedFirst;
+    std::vector<std::string> rendered;
+    std::vector<LineStyle> renderedStyles;
+    mutable std::string scratch;
+
+    // Read-back window into the spill file
+    mutable std::vector<char> chunk;
+    mutable uint64_t chunkOffset;
+
+    void stop();
+    void consume(const char *data, size_t size);
+    void endLine();
+    uint64_t shownRows(const DiffFile &file) const { return file.collapsed ? 1 : file.lines; }
+    void updateRows(size_t fromFile);
+
+    size_t fileOfRow(uint64_t row) const;
+    size_t fileOfLine(uint64_t raw) const;
+    uint64_t rowOfLine(uint64_t raw) const;
+    uint64_t lineOfRow(uint64_t row, size_t file) const;
+
+    std::string rowText(uint64_t row) const;
+    LineStyle styleOf(uint64_t row, std::string_view text) const;
+    std::string readLine(uint64_t raw) const;
+    const char *readAt(uint64_t offset, size_t &available) const;
+
+    bool nextHunk(size_t &cursor) const;
+    bool previousHunk(size_t &cursor) const;
+};
+
+#endif // DIFF_VIEW_H
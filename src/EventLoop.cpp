@@ -0,0 +1,141 @@
+#include "EventLoop.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+EventLoop::EventLoop()
+    : timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      intervalNs(0), lastRedrawNs(0), redrawPending(false), timerArmed(false)
+{
+}
+
+EventLoop::~EventLoop()
+{
+    if (timerFd >= 0)
+        close(timerFd);
+}
+
+void EventLoop::watch(int fd, Handler onReadable)
+{
+    if (fd < 0)
+        return;
+    for (auto &source : sources)
+    {
+        if (source.fd == fd)
+        {
+            source.handler = std::move(onReadable);
+            return;
+        }
+    }
+    sources.push_back({fd, std::move(onReadable)});
+}
+
+void EventLoop::unwatch(int fd)
+{
+    sources.erase(std::remove_if(sources.begin(), sources.end(), [fd](const Source &source)
+                                 { return source.fd == fd; }),
+                  sources.end());
+}
+
+void EventLoop::setRedrawHandler(Handler onRedraw, int intervalMs)
+{
+    redrawHandler = std::move(onRedraw);
+    intervalNs = static_cast<long long>(intervalMs) * 1000000;
+}
+
+void EventLoop::requestRedraw()
+{
+    redrawPending = true;
+}
+
+bool EventLoop::runOnce(int timeoutMs)
+{
+    // Draw what earlier handlers damaged before going to sleep
+    redrawIfDue();
+
+    pollFds.clear();
+    for (const auto &source : sources)
+    {
+        pollFds.push_back({source.fd, POLLIN, 0});
+    }
+    if (timerArmed)
+    {
+        pollFds.push_back({timerFd, POLLIN, 0});
+    }
+
+    int ready = poll(pollFds.data(), pollFds.size(), timeoutMs);
+    if (ready < 0)
+        return errno != EINTR;
+
+    // A handler may run the loop again while a modal prompt waits for a key, and that refills pollFds
+    std::vector<pollfd> results;
+    results.swap(pollFds);
+    for (const pollfd &p : results)
+    {
+        if (p.revents == 0)
+            continue;
+        if (p.fd == timerFd && timerArmed)
+        {
+            uint64_t expirations;
+            ssize_t ignored = read(timerFd, &expirations, sizeof(expirations));
+            (void)ignored;
+            timerArmed = false;
+            continue;
+        }
+
+        // A handler may have unwatched this fd (or closed it) while handling an earlier one
+        auto it = std::find_if(sources.begin(), sources.end(), [&p](const Source &source)
+                               { return source.fd == p.fd; });
+        if (it != sources.end())
+        {
+            Handler handler = it->handler;
+            handler();
+        }
+    }
+    if (pollFds.capacity() < results.capacity())
+    {
+        pollFds.swap(results);
+    }
+    return true;
+}
+
+long long EventLoop::nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void EventLoop::redrawIfDue()
+{
+    if (!redrawPending || !redrawHandler || timerArmed)
+        return;
+
+    long long elapsed = nowNs() - lastRedrawNs;
+    if (elapsed >= intervalNs || timerFd < 0)
+    {
+        redrawPending = false;
+        lastRedrawNs = nowNs();
+        redrawHandler();
+        return;
+    }
+
+    // Drew recently: wake up when the interval is over instead of drawing every event
+    long long remaining = intervalNs - elapsed;
+    itimerspec spec = {};
+    spec.it_value.tv_sec = remaining / 1000000000;
+    spec.it_value.tv_nsec = remaining % 1000000000;
+    if (timerfd_settime(timerFd, 0, &spec, nullptr) == 0)
+    {
+        timerArmed = true;
+    }
+    else
+    {
+        redrawPending = false;
+        lastRedrawNs = nowNs();
+        redrawHandler();
+    }
+}
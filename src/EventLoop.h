@@ -0,0 +1,56 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <functional>
+#include <poll.h>
+#include <vector>
+
+// Single-threaded poll() loop. Callers register file descriptors (terminal
+// input, child pipes, inotify) and a redraw handler; the loop sleeps until
+// one of them is ready. Redraw requests are coalesced through a timerfd so
+// a fast stream of events still produces at most one frame per interval.
+class EventLoop
+{
+public:
+    using Handler = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // Run handler whenever fd is readable or hung up; replaces an earlier registration of fd
+    void watch(int fd, Handler onReadable);
+    void unwatch(int fd);
+
+    // Frames are drawn at most once per intervalMs; the first request after a quiet period draws at once
+    void setRedrawHandler(Handler onRedraw, int intervalMs);
+    void requestRedraw();
+
+    // Draw if a frame is due, then sleep until a source is ready and dispatch it.
+    // Handlers may call it again to wait inside a modal prompt.
+    // Returns false when a signal (e.g. SIGWINCH) interrupted the wait.
+    bool runOnce(int timeoutMs = -1);
+
+private:
+    struct Source
+    {
+        int fd;
+        Handler handler;
+    };
+
+    std::vector<Source> sources;
+    std::vector<pollfd> pollFds; // Rebuilt from sources each iteration
+    int timerFd;
+    Handler redrawHandler;
+    long long intervalNs;
+    long long lastRedrawNs;
+    bool redrawPending;
+    bool timerArmed;
+
+    static long long nowNs();
+    void redrawIfDue();
+};
+
+#endif // EVENT_LOOP_H
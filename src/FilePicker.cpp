@@ -0,0 +1,156 @@
+#include "FilePicker.h"
+#include <algorithm>
+#include "ScreenRenderer.h"
+
+FilePicker::FilePicker(ScreenRenderer &renderer, KeyReader readKey)
+    : renderer(renderer), readKey(std::move(readKey)), pickerWin(nullptr)
+{
+}
+
+FilePicker::~FilePicker()
+{
+    if (pickerWin)
+        delwin(pickerWin);
+}
+
+FilePicker::PickerResult FilePicker::show(const std::string &title, const std::vector<std::string> &items)
+{
+    // Size the window to the list, within the screen
+    int maxY, maxX;
+    getmaxyx(stdscr, maxY, maxX);
+    int width = std::min(maxX - 4, 90);
+    int height = std::min(maxY - 4, static_cast<int>(items.size()) + 2);
+    height = std::max(height, 3);
+    pickerWin = newwin(height, width, (maxY - height) / 2, (maxX - width) / 2);
+    renderer.showOverlay(pickerWin);
+
+    std::vector<char> marked(items.size(), 0);
+    size_t markedCount = 0;
+    size_t current = 0;
+    size_t top = 0;
+    size_t pageSize = static_cast<size_t>(height - 2);
+    bool confirmed = false;
+    bool done = items.empty();
+
+    while (!done)
+    {
+        // Keep the current row inside the visible page
+        if (current < top)
+            top = current;
+        else if (current >= top + pageSize)
+            top = current - pageSize + 1;
+        drawPicker(title, items, marked, markedCount, current, top);
+
+        int ch = readKey();
+        switch (ch)
+        {
+        case KEY_UP:
+        case 'k':
+            if (current > 0)
+                current--;
+            break;
+        case KEY_DOWN:
+        case 'j':
+            if (current + 1 < items.size())
+                current++;
+            break;
+        case KEY_PPAGE:
+            current = current > pageSize ? current - pageSize : 0;
+            break;
+        case KEY_NPAGE:
+            current = std::min(current + pageSize, items.size() - 1);
+            break;
+        case KEY_HOME:
+            current = 0;
+            break;
+        case KEY_END:
+            current = items.size() - 1;
+            break;
+        case ' ':
+            // Toggle and move on, so holding space marks a run of files
+            marked[current] = !marked[current];
+            markedCount += marked[current] ? 1 : -1;
+            if (current + 1 < items.size())
+                current++;
+            break;
+        case 'a':
+        {
+            // Mark everything, or clear when everything is already marked
+            char value = markedCount == items.size() ? 0 : 1;
+            std::fill(marked.begin(), marked.end(), value);
+            markedCount = value ? items.size() : 0;
+            break;
+        }
+        case '\n':
+            confirmed = true;
+            done = true;
+            break;
+        case 27: // ESC
+            done = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    PickerResult result{confirmed, {}};
+    if (confirmed)
+    {
+        if (markedCount == 0)
+        {
+            result.selected.push_back(current);
+        }
+        else
+        {
+            result.selected.reserve(markedCount);
+            for (size_t i = 0; i < items.size(); i++)
+            {
+                if (marked[i])
+                    result.selected.push_back(i);
+            }
+        }
+    }
+
+    // Clean up
+    renderer.hideOverlay(pickerWin);
+    delwin(pickerWin);
+    pickerWin = nullptr;
+
+    return result;
+}
+
+void FilePicker::drawPicker(const std::string &title,
+                            const std::vector<std::string> &items,
+                            const std::vector<char> &marked,
+                            size_t markedCount,
+                            size_t current,
+                            size_t top)
+{
+    int height, width;
+    getmaxyx(pickerWin, height, width);
+
+    werase(pickerWin);
+    box(pickerWin, 0, 0);
+    std::string heading = " " + title + " (" + std::to_string(markedCount) + "/" + std::to_string(items.size()) + " selected) ";
+    ScreenRenderer::drawLine(pickerWin, 0, 2, heading, width - 4);
+
+    for (int row = 0; row < height - 2 && top + row < items.size(); row++)
+    {
+        size_t index = top + row;
+        std::string text = marked[index] ? "[x] " : "[ ] ";
+        text += items[index];
+        if (index == current)
+            wattron(pickerWin, A_REVERSE);
+        ScreenRenderer::drawLine(pickerWin, row + 1, 1, text, width - 2);
+        if (index == current)
+        {
+            // Extend the highlight across the row
+            for (int x = getcurx(pickerWin); x < width - 1; x++)
+                waddch(pickerWin, ' ');
+            wattroff(pickerWin, A_REVERSE);
+        }
+    }
+
+    ScreenRenderer::drawLine(pickerWin, height - 1, 2, " Space: mark  a: all  Enter: confirm  ESC: cancel ", width - 4);
+    renderer.markDirty(pickerWin);
+}
@@ -0,0 +1,44 @@
+#ifndef FILE_PICKER_H
+#define FILE_PICKER_H
+
+#include <functional>
+#include <ncurses.h>
+#include <string>
+#include <vector>
+
+class ScreenRenderer;
+
+// Modal multi-select list. Only the visible rows are drawn, so a list of
+// thousands of files opens and scrolls as fast as a short one. It is a popup
+// panel fed by readKey, so the owner's event loop runs while it is open.
+class FilePicker
+{
+public:
+    using KeyReader = std::function<int()>;
+
+    struct PickerResult
+    {
+        bool confirmed;
+        std::vector<size_t> selected; // Indices into items, in list order
+    };
+
+    FilePicker(ScreenRenderer &renderer, KeyReader readKey);
+    ~FilePicker();
+
+    // Show items and let the user mark some of them; Enter with nothing marked picks the current row
+    PickerResult show(const std::string &title, const std::vector<std::string> &items);
+
+private:
+    ScreenRenderer &renderer;
+    KeyReader readKey;
+    WINDOW *pickerWin;
+
+    void drawPicker(const std::string &title,
+                    const std::vector<std::string> &items,
+                    const std::vector<char> &marked,
+                    size_t markedCount,
+                    size_t current,
+                    size_t top);
+};
+
+#endif // FILE_PICKER_H
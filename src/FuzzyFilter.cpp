@@ -0,0 +1,146 @@
+#include "FuzzyFilter.h"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    bool isSeparator(char c)
+    {
+        return c == '/' || c == '-' || c == '_' || c == '.';
+    }
+}
+
+FuzzyFilter::FuzzyFilter()
+{
+}
+
+void FuzzyFilter::setItems(std::vector<std::string> items)
+{
+    itemList = std::move(items);
+    index.clear();
+    index.reserve(itemList.size());
+    for (const auto &item : itemList)
+    {
+        std::string lower = toLower(item);
+        uint64_t mask = maskOf(lower);
+        index.push_back({std::move(lower), mask});
+    }
+
+    currentQuery.clear();
+    lowerQuery.clear();
+    matches.resize(itemList.size());
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        matches[i] = static_cast<uint32_t>(i);
+    }
+}
+
+void FuzzyFilter::setQuery(const std::string &query)
+{
+    if (query == currentQuery)
+        return;
+
+    std::string lower = toLower(query);
+
+    // Typing one more character can only narrow the result, so start from the previous matches
+    std::vector<uint32_t> candidates;
+    if (!lowerQuery.empty() && lower.compare(0, lowerQuery.size(), lowerQuery) == 0)
+    {
+        candidates.swap(matches);
+    }
+    else
+    {
+        candidates.resize(itemList.size());
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            candidates[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    currentQuery = query;
+    lowerQuery = lower;
+    matches.clear();
+    if (lower.empty())
+    {
+        matches = std::move(candidates);
+        std::sort(matches.begin(), matches.end());
+        return;
+    }
+
+    uint64_t queryMask = maskOf(lower);
+    std::vector<std::pair<int, uint32_t>> scored;
+    for (uint32_t i : candidates)
+    {
+        const IndexEntry &entry = index[i];
+        if ((entry.charMask & queryMask) != queryMask)
+            continue;
+        int s = score(entry.lower, lower);
+        if (s >= 0)
+        {
+            scored.emplace_back(s, i);
+        }
+    }
+
+    // Best score first, ties keep the original (sorted) order
+    std::sort(scored.begin(), scored.end(), [](const auto &a, const auto &b)
+              { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+    matches.reserve(scored.size());
+    for (const auto &entry : scored)
+    {
+        matches.push_back(entry.second);
+    }
+}
+
+std::string FuzzyFilter::toLower(const std::string &text)
+{
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+    return lower;
+}
+
+uint64_t FuzzyFilter::maskOf(const std::string &lower)
+{
+    // One bit per letter and digit, a few for common ref separators, one shared by everything else
+    uint64_t mask = 0;
+    for (unsigned char c : lower)
+    {
+        int bit;
+        if (c >= 'a' && c <= 'z')
+            bit = c - 'a';
+        else if (c >= '0' && c <= '9')
+            bit = 26 + (c - '0');
+        else if (isSeparator(c))
+            bit = 36 + (c == '/' ? 0 : c == '-' ? 1 : c == '_' ? 2 : 3);
+        else
+            bit = 63;
+        mask |= uint64_t(1) << bit;
+    }
+    return mask;
+}
+
+int FuzzyFilter::score(const std::string &candidate, const std::string &query)
+{
+    int total = 0;
+    size_t pos = 0;
+    size_t previous = std::string::npos;
+    for (char q : query)
+    {
+        size_t found = candidate.find(q, pos);
+        if (found == std::string::npos)
+            return -1;
+
+        if (found == 0 || isSeparator(candidate[found - 1]))
+            total += 8; // Start of a path component or word
+        if (previous != std::string::npos && found == previous + 1)
+            total += 5; // Contiguous run
+        else if (previous != std::string::npos)
+            total -= std::min<int>(found - previous - 1, 5);
+
+        previous = found;
+        pos = found + 1;
+    }
+
+    // Prefer shorter names when everything else is equal
+    return std::max(0, total * 4 + 64 - static_cast<int>(std::min<size_t>(candidate.size(), 64)));
+}
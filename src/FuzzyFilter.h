@@ -0,0 +1,49 @@
+#ifndef FUZZY_FILTER_H
+#define FUZZY_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Incremental fuzzy matcher for long pick lists such as the branch menu.
+// setItems builds a lowercase copy and a character-set mask per item once;
+// each query then rejects most items with one mask test, and a query that
+// extends the previous one only rescans the items that matched before.
+class FuzzyFilter
+{
+public:
+    FuzzyFilter();
+
+    // Replace the item list, rebuild the index and clear the query
+    void setItems(std::vector<std::string> items);
+    size_t itemCount() const { return itemList.size(); }
+
+    // Items whose characters contain the query as a subsequence (case-insensitive),
+    // best matches first; an empty query matches everything in original order
+    void setQuery(const std::string &query);
+    const std::string &query() const { return currentQuery; }
+
+    size_t matchCount() const { return matches.size(); }
+    const std::string &match(size_t i) const { return itemList[matches[i]]; }
+
+private:
+    struct IndexEntry
+    {
+        std::string lower;
+        uint64_t charMask;
+    };
+
+    std::vector<std::string> itemList;
+    std::vector<IndexEntry> index;
+    std::string currentQuery;
+    std::string lowerQuery;
+    std::vector<uint32_t> matches; // Indices into itemList, ranked
+
+    static std::string toLower(const std::string &text);
+    static uint64_t maskOf(const std::string &lower);
+
+    // Greedy subsequence score, higher is better; -1 when the query does not match
+    static int score(const std::string &candidate, const std::string &query);
+};
+
+#endif // FUZZY_FILTER_H
@@ -1,37 +1,54 @@
 #include "GitCommandHandler.h"
 #include <cstdio>
+#include <cstdlib>
 
 GitCommandHandler::GitCommandHandler()
+    : repoState{"", "", false, 0, 0}, staleParts(StateAll), untrackedScan(true), branchStats{0, 0}, stateStats{0, 0}
 {
+    // GITNCURSES_UNTRACKED=no selects the fast tier for huge worktrees
+    const char *untracked = getenv("GITNCURSES_UNTRACKED");
+    if (untracked && std::string(untracked) == "no")
+    {
+        untrackedScan = false;
+    }
+
+    refReader.open();
     updateLocalBranches();
 }
 
-std::string GitCommandHandler::executeGitCommand(const std::string &command)
+ProcessResult GitCommandHandler::runGit(const std::vector<std::string> &args, size_t maxOutput)
 {
-    std::string fullCommand = "git " + command;
-    std::array<char, 128> buffer;
-    std::string result;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(fullCommand.c_str(), "r"), pclose);
-
-    if (!pipe)
-    {
-        throw std::runtime_error("popen() failed!");
-    }
+    std::vector<std::string> argv;
+    argv.reserve(args.size() + 1);
+    argv.push_back("git");
+    argv.insert(argv.end(), args.begin(), args.end());
+    return runner.run(argv, maxOutput);
+}
 
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr)
-    {
-        result += buffer.data();
-    }
+std::string GitCommandHandler::executeGitCommand(const std::string &command)
+{
+    return executeGitCommand(ProcessRunner::splitArgs(command));
+}
 
-    return result;
+std::string GitCommandHandler::executeGitCommand(const std::vector<std::string> &args)
+{
+    // stderr carries git's progress and error messages, show it after stdout
+    ProcessResult result = runGit(args);
+    return result.output + result.error;
 }
 
 std::vector<std::string> GitCommandHandler::getLocalBranches()
 {
     std::vector<std::string> branches;
+    if (refReader.readLocalBranches(branches))
+    {
+        return branches;
+    }
+
     try
     {
-        std::string output = executeGitCommand("branch --format='%(refname:short)'");
+        ProcessResult result = runGit({"branch", "--format=%(refname:short)"});
+        std::string &output = result.output;
         std::istringstream iss(output);
         std::string branch;
         while (std::getline(iss, branch))
@@ -49,16 +66,43 @@ std::vector<std::string> GitCommandHandler::getLocalBranches()
     return branches;
 }
 
-void GitCommandHandler::updateLocalBranches()
+bool GitCommandHandler::updateLocalBranches()
 {
-    localBranches = getLocalBranches();
+    branchStats.misses++;
+    return localBranches.assign(getLocalBranches());
+}
+
+bool GitCommandHandler::updateLocalBranches(const RepoChanges &changes)
+{
+    if (changes.rescan || !refReader.isOpen())
+        return updateLocalBranches();
+    branchStats.hits++;
+
+    // Git rewrites packed-refs whenever it deletes a packed branch, so without a
+    // packed-refs event a branch exists exactly when its loose file does
+    bool changed = false;
+    for (const auto &name : changes.branches)
+    {
+        changed |= refReader.hasLooseBranch(name) ? localBranches.insert(name) : localBranches.erase(name);
+    }
+    return changed;
 }
 
 std::string GitCommandHandler::getCurrentBranch()
 {
+    std::string branch;
+    bool detached = false;
+    if (refReader.readHead(branch, detached))
+    {
+        return detached ? "detached HEAD" : branch;
+    }
+
     try
     {
-        std::string output = executeGitCommand("branch --show-current");
+        ProcessResult result = runGit({"branch", "--show-current"});
+        if (result.exitCode != 0)
+            return "unknown";
+        std::string &output = result.output;
         if (output.empty())
             return "detached HEAD";
         return output.substr(0, output.length() - 1); // Remove trailing newline
@@ -71,83 +115,310 @@ std::string GitCommandHandler::getCurrentBranch()
 
 std::string GitCommandHandler::getRepositoryStatus()
 {
-    try
+    switch (checkDirty())
     {
-        std::string output = executeGitCommand("status --porcelain");
-        if (output.empty())
-            return "Clean";
+    case DirtyState::Clean:
+        return "Clean";
+    case DirtyState::Modified:
         return "Modified";
+    case DirtyState::UntrackedOnly:
+        return "Untracked";
+    default:
+        return "Error";
+    }
+}
+
+DirtyState GitCommandHandler::checkDirty()
+{
+    try
+    {
+        // --quiet makes diff exit 1 at the first changed file; --no-optional-locks keeps .git/index untouched
+        ProcessResult unstaged = runGit({"--no-optional-locks", "diff", "--no-ext-diff", "--quiet"});
+        if (unstaged.exitCode == 1)
+            return DirtyState::Modified;
+        if (unstaged.exitCode != 0)
+            return DirtyState::Unknown;
+
+        ProcessResult staged = runGit({"--no-optional-locks", "diff", "--no-ext-diff", "--cached", "--quiet"});
+        if (staged.exitCode == 1)
+            return DirtyState::Modified;
+        if (staged.exitCode != 0)
+            return DirtyState::Unknown;
+
+        if (!untrackedScan)
+            return DirtyState::Clean;
+
+        // One byte of output proves an untracked file exists; git is stopped right there
+        ProcessResult untracked = runGit({"ls-files", "--others", "--exclude-standard", "--directory",
+                                          "--no-empty-directory", "-z", "--", ":/"},
+                                         1);
+        if (untracked.truncated)
+            return DirtyState::UntrackedOnly;
+        return untracked.exitCode == 0 ? DirtyState::Clean : DirtyState::Unknown;
     }
     catch (...)
     {
-        return "Error";
+        return DirtyState::Unknown;
     }
 }
 
-std::string GitCommandHandler::executeCommand(const std::string &command)
+const RepoState &GitCommandHandler::getRepoState()
 {
-    std::string cmd = command;
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c)
-                   { return std::tolower(c); });
+    if (staleParts)
+    {
+        stateStats.misses++;
+        refreshRepoState();
+    }
+    else
+    {
+        stateStats.hits++;
+    }
+    return repoState;
+}
 
-    if (cmd == "help")
+void GitCommandHandler::refreshRepoState()
+{
+    if (staleParts & StateBranch)
     {
-        return "Available commands:\n"
-               "  status    - Show working tree status\n"
-               "  branch    - List branches\n"
-               "  log       - Show commit logs\n"
-               "  add       - Add file contents to index\n"
-               "  commit    - Record changes to repository\n"
-               "  push      - Update remote refs\n"
-               "  pull      - Fetch and integrate changes\n"
-               "  help      - Show this help message\n"
-               "  exit      - Exit the application\n";
+        repoState.branch = getCurrentBranch();
     }
+    if (staleParts & StateDirty)
+    {
+        repoState.status = getRepositoryStatus();
+    }
+    if (staleParts & StateUpstream)
+    {
+        repoState.hasUpstream = false;
+        repoState.ahead = 0;
+        repoState.behind = 0;
+        try
+        {
+            // Fails without an upstream, which simply leaves the counts at zero
+            ProcessResult result = runGit({"rev-list", "--left-right", "--count", "HEAD...@{upstream}"});
+            if (result.exitCode == 0)
+            {
+                std::istringstream iss(result.output);
+                repoState.hasUpstream = static_cast<bool>(iss >> repoState.ahead >> repoState.behind);
+            }
+        }
+        catch (...)
+        {
+        }
+    }
+    staleParts = 0;
+}
+
+bool GitCommandHandler::getGitDirs(std::string &gitDir, std::string &commonDir)
+{
+    if (refReader.isOpen())
+    {
+        gitDir = refReader.gitDir();
+        commonDir = refReader.commonDir();
+        return true;
+    }
+
+    try
+    {
+        ProcessResult result = runGit({"rev-parse", "--path-format=absolute", "--git-dir", "--git-common-dir"});
+        if (result.exitCode != 0)
+            return false;
+        std::istringstream iss(result.output);
+        return static_cast<bool>(std::getline(iss, gitDir) && std::getline(iss, commonDir));
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
 
+bool GitCommandHandler::getWorkTree(std::string &workTree)
+{
     try
     {
-        std::string fullCommand;
-        std::string output;
+        ProcessResult result = runGit({"rev-parse", "--show-toplevel"});
+        if (result.exitCode != 0 || result.output.empty())
+            return false;
+        workTree = result.output.substr(0, result.output.find('\n'));
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
 
-        // Handle Branch menu commands
-        if (cmd == "add")
+std::set<std::string> GitCommandHandler::getIgnoredDirectories(const std::string &workTree)
+{
+    std::set<std::string> dirs;
+    try
+    {
+        // --directory collapses a fully ignored directory (build/, node_modules/) into one entry
+        ProcessResult result = runGit({"-C", workTree, "ls-files", "-z", "--others", "--ignored",
+                                       "--exclude-standard", "--directory"},
+                                      4 * 1024 * 1024);
+        size_t start = 0;
+        while (start < result.output.size())
         {
-            fullCommand = "git add .";
-            output = addFiles();
+            size_t end = result.output.find('\0', start);
+            if (end == std::string::npos)
+                break; // Truncated entry
+            std::string path = result.output.substr(start, end - start);
+            if (!path.empty() && path.back() == '/')
+            {
+                path.pop_back();
+                dirs.insert(workTree + "/" + path);
+            }
+            start = end + 1;
         }
-        else if (cmd.substr(0, 7) == "commit ")
+    }
+    catch (...)
+    {
+    }
+    return dirs;
+}
+
+bool GitCommandHandler::isIgnored(const std::string &workTree, const std::string &path)
+{
+    try
+    {
+        // Exits 0 when the path is ignored, 1 when it is not
+        return runGit({"-C", workTree, "check-ignore", "-q", "--", path}).exitCode == 0;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+bool GitCommandHandler::isReadOnlyCommand(const std::vector<std::string> &args)
+{
+    static const std::vector<std::string> readOnly = {
+        "status", "log", "diff", "show", "blame", "grep", "shortlog", "describe",
+        "ls-files", "rev-parse", "cat-file", "reflog", "help", "version"};
+
+    if (args.empty())
+        return true;
+    const std::string &verb = args[0];
+    if (std::find(readOnly.begin(), readOnly.end(), verb) != readOnly.end())
+        return true;
+    if (verb == "stash")
+        return args.size() > 1 && (args[1] == "list" || args[1] == "show");
+    if (verb == "branch" || verb == "tag" || verb == "remote")
+    {
+        // Listing forms only carry flags such as -v, -a or --list; any name means create/delete
+        return std::all_of(args.begin() + 1, args.end(), [](const std::string &arg)
+                           { return !arg.empty() && arg[0] == '-'; });
+    }
+    return false;
+}
+
+GitInvocation GitCommandHandler::prepareCommand(const std::string &command)
+{
+    std::string cmd = command;
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+
+    GitInvocation invocation;
+    invocation.refreshBranches = false;
+    invocation.mutating = false;
+
+    if (cmd == "help")
+    {
+        invocation.output = "Available commands:\n"
+                            "  status    - Show working tree status\n"
+                            "  branch    - List branches\n"
+                            "  log       - Show commit logs\n"
+                            "  add       - Add file contents to index\n"
+                            "  commit    - Record changes to repository\n"
+                            "  push      - Update remote refs\n"
+                            "  pull      - Fetch and integrate changes\n"
+                            "  help      - Show this help message\n"
+                            "  exit      - Exit the application\n";
+        return invocation;
+    }
+
+    // Handle Branch menu commands
+    if (cmd == "add")
+    {
+        invocation.display = "git add .";
+        invocation.args = {"add", "."};
+        invocation.emptyMessage = "Files added successfully.";
+    }
+    else if (cmd.substr(0, 7) == "commit ")
+    {
+        // Accept both "commit <message>" and "commit -m <message>"
+        std::string message = command.substr(7);
+        std::vector<std::string> args = ProcessRunner::splitArgs(message);
+        if (args.size() == 2 && args[0] == "-m")
         {
-            std::string message = cmd.substr(7);
-            fullCommand = "git commit -m \"" + message + "\"";
-            output = commitChanges(message);
+            message = args[1];
         }
-        else if (cmd == "push")
+        invocation.display = "git commit -m \"" + message + "\"";
+        if (message.empty())
         {
-            fullCommand = "git push";
-            output = pushChanges();
+            invocation.output = "Error: Commit message cannot be empty.";
+            return invocation;
         }
-        else if (cmd == "pull")
+        invocation.args = {"commit", "-m", message};
+        invocation.emptyMessage = "No changes to commit.";
+    }
+    else if (cmd == "push")
+    {
+        invocation.display = "git push";
+        invocation.args = {"push", "origin"};
+        invocation.emptyMessage = "No changes to push.";
+    }
+    else if (cmd == "pull")
+    {
+        invocation.display = "git fetch";
+        invocation.args = {"pull", "origin"};
+        invocation.emptyMessage = "No changes to pull.";
+    }
+    // Check if the command is a branch name (for switching)
+    else if (isLocalBranch(command))
+    {
+        invocation.display = "git checkout " + command;
+        invocation.args = {"checkout", command};
+
+        // Update branch list if we switched branches
+        invocation.refreshBranches = true;
+    }
+    else
+    {
+        invocation.display = "git " + command;
+        invocation.args = ProcessRunner::splitArgs(command);
+    }
+
+    invocation.mutating = !isReadOnlyCommand(invocation.args);
+    return invocation;
+}
+
+std::string GitCommandHandler::executeCommand(const std::string &command)
+{
+    GitInvocation invocation = prepareCommand(command);
+    if (invocation.args.empty())
+    {
+        return invocation.output;
+    }
+
+    try
+    {
+        std::string output = executeGitCommand(invocation.args);
+        if (output.empty())
         {
-            fullCommand = "git fetch";
-            output = pullChanges();
+            output = invocation.emptyMessage;
         }
-        // Check if the command is a branch name (for switching)
-        else if (std::find(localBranches.begin(), localBranches.end(), command) != localBranches.end())
+        if (invocation.refreshBranches)
         {
-            fullCommand = "git checkout " + command;
-            output = executeGitCommand(cmd);
-
-            // Update branch list if we switched branches
             updateLocalBranches();
         }
-        else
+        if (invocation.mutating)
         {
-            fullCommand = "git " + cmd;
-            output = executeGitCommand(cmd);
+            invalidateRepoState();
         }
 
         // Combine command and output
-        std::string combinedOutput = "$ " + fullCommand + "\n\n" + output;
+        std::string combinedOutput = "$ " + invocation.display + "\n\n" + output;
         return combinedOutput;
     }
     catch (const std::exception &e)
@@ -158,15 +429,16 @@ std::string GitCommandHandler::executeCommand(const std::string &command)
 
 bool GitCommandHandler::isLocalBranch(const std::string &branchName) const
 {
-    return std::find(localBranches.begin(), localBranches.end(), branchName) != localBranches.end();
+    return localBranches.contains(branchName);
 }
 
 std::string GitCommandHandler::addFiles(const std::string &files)
 {
     try
     {
-        std::string command = "add " + files;
-        std::string output = executeGitCommand(command);
+        std::vector<std::string> args = ProcessRunner::splitArgs(files);
+        args.insert(args.begin(), "add");
+        std::string output = executeGitCommand(args);
         if (output.empty())
         {
             return "Files added successfully.";
@@ -179,26 +451,160 @@ std::string GitCommandHandler::addFiles(const std::string &files)
     }
 }
 
-std::string GitCommandHandler::commitChanges(const std::string &message)
+std::string GitCommandHandler::hashFile(const std::string &path)
 {
     try
     {
-        if (message.empty())
+        ProcessResult result = runGit({"hash-object", "--", path});
+        if (result.exitCode != 0)
         {
-            return "Error: Commit message cannot be empty.";
+            return "";
+        }
+        std::string id = result.output;
+        id.erase(id.find_last_not_of("\n") + 1);
+        return id;
+    }
+    catch (const std::exception &)
+    {
+        return "";
+    }
+}
+
+std::string GitCommandHandler::getHeadCommit()
+{
+    std::string oid;
+    if (refReader.readHeadCommit(oid))
+        return oid;
+
+    try
+    {
+        ProcessResult result = runGit({"rev-parse", "-q", "--verify", "HEAD"});
+        if (result.exitCode != 0)
+            return "";
+        oid = result.output;
+        oid.erase(oid.find_last_not_of("\n") + 1);
+        return oid;
+    }
+    catch (const std::exception &)
+    {
+        return "";
+    }
+}
+
+std::vector<ChangedFile> GitCommandHandler::getUnstagedFiles()
+{
+    std::vector<ChangedFile> files;
+    std::vector<std::string> args = {"--no-optional-locks", "status", "--porcelain", "-z"};
+    if (!untrackedScan)
+    {
+        args.push_back("-uno");
+    }
+    ProcessResult result = runGit(args);
+    if (result.exitCode != 0)
+    {
+        throw std::runtime_error(result.error.empty() ? "git status failed" : result.error);
+    }
+
+    // Records are "XY path\0", renames and copies add the source path as a record of its own
+    const std::string &output = result.output;
+    size_t pos = 0;
+    while (pos < output.size())
+    {
+        size_t end = output.find('\0', pos);
+        if (end == std::string::npos)
+            end = output.size();
+        if (end - pos > 3)
+        {
+            char x = output[pos];
+            char y = output[pos + 1];
+            if (y != ' ')
+            {
+                files.push_back({output.substr(pos + 3, end - pos - 3), x, y});
+            }
+            if (x == 'R' || x == 'C')
+            {
+                end = output.find('\0', end + 1);
+                if (end == std::string::npos)
+                    break;
+            }
+        }
+        pos = end + 1;
+    }
+    return files;
+}
+
+namespace
+{
+    // NUL-separated list for --pathspec-from-file=- --pathspec-file-nul
+    std::string joinPathspecs(const std::vector<std::string> &paths)
+    {
+        std::string list;
+        for (const auto &path : paths)
+        {
+            list += path;
+            list += '\0';
+        }
+        return list;
+    }
+}
+
+std::string GitCommandHandler::stagePaths(const std::vector<std::string> &paths)
+{
+    try
+    {
+        // -A stages deletions too; literal pathspecs keep '*' or '[' in a name from matching others.
+        // Paths go over stdin so any number of them costs one spawn and no argv limits.
+        ProcessResult result = runner.runWithInput(
+            {"git", "--literal-pathspecs", "add", "-A", "--pathspec-from-file=-", "--pathspec-file-nul"},
+            joinPathspecs(paths));
+        return result.exitCode == 0 ? "" : result.error;
+    }
+    catch (const std::exception &e)
+    {
+        return std::string("Error staging: ") + e.what();
+    }
+}
+
+std::string GitCommandHandler::unstagePaths(const std::vector<std::string> &paths)
+{
+    try
+    {
+        std::string list = joinPathspecs(paths);
+        ProcessResult result = runner.runWithInput(
+            {"git", "--literal-pathspecs", "restore", "--staged", "--pathspec-from-file=-", "--pathspec-file-nul"},
+            list);
+        if (result.exitCode == 0)
+        {
+            return "";
+        }
+        if (runGit({"rev-parse", "--verify", "-q", "HEAD"}).exitCode == 0)
+        {
+            return result.error;
         }
 
-        // Escape quotes in the message
-        std::string escapedMessage = message;
-        size_t pos = 0;
-        while ((pos = escapedMessage.find("\"", pos)) != std::string::npos)
+        // Before the first commit there is no HEAD to restore from; dropping the entries is the same thing
+        ProcessResult fallback = runner.runWithInput(
+            {"git", "--literal-pathspecs", "rm", "--cached", "-q", "-r", "--pathspec-from-file=-", "--pathspec-file-nul"},
+            list);
+        return fallback.exitCode == 0 ? "" : result.error;
+    }
+    catch (const std::exception &e)
+    {
+        return std::string("Error unstaging: ") + e.what();
+    }
+}
+
+std::string GitCommandHandler::commitChanges(const std::string &message)
+{
+    try
+    {
+        if (message.empty())
         {
-            escapedMessage.replace(pos, 1, "\\\"");
-            pos += 2;
+            return "Error: Commit message cannot be empty.";
         }
 
-        std::string command = "commit -m \"" + escapedMessage + "\"";
-        std::string output = executeGitCommand(command);
+        // The message is passed as a single argument, no shell quoting needed
+        std::string output = executeGitCommand(std::vector<std::string>{"commit", "-m", message});
         if (output.empty())
         {
             return "No changes to commit.";
@@ -215,12 +621,12 @@ std::string GitCommandHandler::pushChanges(const std::string &remote, const std:
 {
     try
     {
-        std::string command = "push " + remote;
+        std::vector<std::string> args = {"push", remote};
         if (!branch.empty())
         {
-            command += " " + branch;
+            args.push_back(branch);
         }
-        std::string output = executeGitCommand(command);
+        std::string output = executeGitCommand(args);
         if (output.empty())
         {
             return "No changes to push.";
@@ -237,12 +643,12 @@ std::string GitCommandHandler::pullChanges(const std::string &remote, const std:
 {
     try
     {
-        std::string command = "pull " + remote;
+        std::vector<std::string> args = {"pull", remote};
         if (!branch.empty())
         {
-            command += " " + branch;
+            args.push_back(branch);
         }
-        std::string output = executeGitCommand(command);
+        std::string output = executeGitCommand(args);
         if (output.empty())
         {
             return "No changes to pull.";
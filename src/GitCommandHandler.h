@@ -3,24 +3,129 @@
 
 #include <string>
 #include <vector>
+#include <set>
 #include <array>
 #include <memory>
 #include <stdexcept>
 #include <sstream>
 #include <algorithm>
+#include "ProcessRunner.h"
+#include "RefReader.h"
+#include "BranchSet.h"
+#include "Instrumentation.h"
+#include "RepoWatcher.h"
+
+// A user command resolved into git arguments, ready to run synchronously or in the background
+struct GitInvocation
+{
+    std::string display;           // Command line shown above the output
+    std::vector<std::string> args; // Arguments after "git"; empty when output is already known
+    std::string output;            // Immediate output when no git process is needed
+    std::string emptyMessage;      // Shown when git prints nothing
+    bool refreshBranches;          // Branch list must be reloaded afterwards
+    bool mutating;                 // May change HEAD, the index or refs
+};
+
+// Result of the bounded-cost dirty check
+enum class DirtyState
+{
+    Clean,
+    Modified,      // Staged or unstaged changes to tracked files
+    UntrackedOnly, // Only untracked files
+    Unknown        // git failed (not a repository, ...)
+};
+
+// Parts of RepoState that are refreshed independently
+enum RepoStatePart : unsigned
+{
+    StateBranch = 1 << 0,   // Current branch, from HEAD
+    StateDirty = 1 << 1,    // Clean/modified/untracked, from the index and worktree
+    StateUpstream = 1 << 2, // Ahead/behind counts, from HEAD and remote refs
+    StateAll = StateBranch | StateDirty | StateUpstream
+};
+
+// A path with changes that `git add` would pick up
+struct ChangedFile
+{
+    std::string path;
+    char index;    // Short-format status letters, ' ' when unchanged
+    char workTree; // '?' for untracked files
+};
+
+// Cached facts shown in the status bar
+struct RepoState
+{
+    std::string branch;
+    std::string status;
+    bool hasUpstream;
+    int ahead;
+    int behind;
+};
 
 class GitCommandHandler
 {
 private:
-    std::vector<std::string> localBranches;
+    BranchSet localBranches;
+    ProcessRunner runner;
+    RefReader refReader; // Answers branch queries from .git files without spawning git
+    RepoState repoState;
+    unsigned staleParts; // RepoStatePart bits still to refresh
+    void refreshRepoState();
+    static bool isReadOnlyCommand(const std::vector<std::string> &args);
+    bool untrackedScan; // Fast tier skips the untracked-file walk
+    mutable CacheStats branchStats; // Branch queries served from localBranches vs full ref re-reads
+    CacheStats stateStats;          // getRepoState calls with nothing stale vs refreshes
+    ProcessResult runGit(const std::vector<std::string> &args, size_t maxOutput = SIZE_MAX);
     std::string executeGitCommand(const std::string &command);
+    std::string executeGitCommand(const std::vector<std::string> &args);
 
 public:
     GitCommandHandler();
     std::vector<std::string> getLocalBranches();
-    void updateLocalBranches();
+
+    // Reload the cached branch set; both return true when it changed
+    bool updateLocalBranches();
+    // Apply loose ref events from RepoWatcher without re-reading every ref
+    bool updateLocalBranches(const RepoChanges &changes);
+    std::vector<std::string> cachedLocalBranches() const
+    {
+        branchStats.hits++;
+        return localBranches.list();
+    }
+    std::vector<std::string> branchesWithPrefix(const std::string &prefix, size_t limit = SIZE_MAX) const
+    {
+        branchStats.hits++;
+        return localBranches.withPrefix(prefix, limit);
+    }
+    std::string branchCommonPrefix(const std::string &prefix) const
+    {
+        branchStats.hits++;
+        return localBranches.commonPrefix(prefix);
+    }
+    CacheStats branchCacheStats() const { return branchStats; }
     std::string getCurrentBranch();
     std::string getRepositoryStatus();
+
+    // Stops at the first difference instead of listing the whole tree
+    DirtyState checkDirty();
+    void setUntrackedScan(bool enabled) { untrackedScan = enabled; }
+    bool getUntrackedScan() const { return untrackedScan; }
+
+    // Repository state cache; only the invalidated parts are refreshed on the next read
+    const RepoState &getRepoState();
+    void invalidateRepoState(unsigned parts = StateAll) { staleParts |= parts; }
+    bool isRepoStateStale() const { return staleParts != 0; }
+    CacheStats repoStateCacheStats() const { return stateStats; }
+
+    // Absolute git dir and common dir (they differ inside linked worktrees)
+    bool getGitDirs(std::string &gitDir, std::string &commonDir);
+    // Absolute top-level directory of the working tree; false for bare repositories
+    bool getWorkTree(std::string &workTree);
+    // Absolute paths of ignored directories below workTree, which need no watching
+    std::set<std::string> getIgnoredDirectories(const std::string &workTree);
+    // Whether git ignores path, a file or directory below workTree
+    bool isIgnored(const std::string &workTree, const std::string &path);
+    GitInvocation prepareCommand(const std::string &command);
     std::string executeCommand(const std::string &command);
     bool isLocalBranch(const std::string &branchName) const;
 
@@ -29,6 +134,18 @@ public:
     std::string commitChanges(const std::string &message);
     std::string pushChanges(const std::string &remote = "origin", const std::string &branch = "");
     std::string pullChanges(const std::string &remote = "origin", const std::string &branch = "");
+
+    // Object id of a worktree file's current content, empty when it cannot be read
+    std::string hashFile(const std::string &path);
+    // Commit id HEAD points at, empty before the first commit
+    std::string getHeadCommit();
+
+    // Files with unstaged or untracked changes, from `git status --porcelain -z`
+    std::vector<ChangedFile> getUnstagedFiles();
+
+    // Stage or unstage exact paths in one git call each, passing them on stdin; return git's error text, empty on success
+    std::string stagePaths(const std::vector<std::string> &paths);
+    std::string unstagePaths(const std::vector<std::string> &paths);
 };
 
 #endif // GIT_COMMAND_HANDLER_H
\ No newline at end of file
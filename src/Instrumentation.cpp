@@ -0,0 +1,215 @@
+#include "Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+#include "json.hpp"
+
+namespace
+{
+    // Long sessions stop adding trace events here rather than growing without bound
+    const size_t kMaxTraceEvents = 1000000;
+
+    int64_t monotonicUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+}
+
+Instrumentation &Instrumentation::instance()
+{
+    static Instrumentation instrumentation;
+    return instrumentation;
+}
+
+Instrumentation::Instrumentation()
+    : sessionStart(monotonicUs()), measureRequested(false), ioFd(-1), droppedEvents(0), processesSpawned(0),
+      lastProcess{-1, "", 0, 0, -1, 0, 0, 0}, currentFrame{0, 0, 0, 0}, lastFrame{0, 0, 0, 0},
+      recentFrames{0, 0, 0, 0}, frameOpen(false),
+      bytesAtFlush(0)
+{
+    const char *path = getenv("GITNCURSES_TRACE");
+    if (path && *path)
+        tracePath = path;
+}
+
+Instrumentation::~Instrumentation()
+{
+    // Runs from exit() too, so sessions ended by the exit command are written as well.
+    // Nothing may escape a static destructor: a failed write just loses the trace.
+    try
+    {
+        writeTrace();
+    }
+    catch (...)
+    {
+    }
+    if (ioFd >= 0)
+        close(ioFd);
+}
+
+int64_t Instrumentation::nowUs() const
+{
+    return monotonicUs() - sessionStart;
+}
+
+void Instrumentation::processSpawned(pid_t pid, const std::vector<std::string> &argv, int64_t startUs)
+{
+    std::string command;
+    for (const auto &arg : argv)
+    {
+        if (!command.empty())
+            command += ' ';
+        command += arg;
+    }
+    int64_t now = nowUs();
+    running[pid] = {pid, std::move(command), startUs, now - startUs, -1, 0, 0, 0};
+    processesSpawned++;
+}
+
+void Instrumentation::processOutput(pid_t pid, size_t bytes)
+{
+    auto it = running.find(pid);
+    if (it == running.end())
+        return;
+    if (it->second.firstByteUs < 0)
+        it->second.firstByteUs = nowUs() - it->second.startUs;
+    it->second.bytes += bytes;
+}
+
+void Instrumentation::processExited(pid_t pid, int exitCode)
+{
+    auto it = running.find(pid);
+    if (it == running.end())
+        return;
+    it->second.endUs = nowUs();
+    it->second.exitCode = exitCode;
+    lastProcess = std::move(it->second);
+    running.erase(it);
+
+    if (!tracing())
+        return;
+    if (finishedProcesses.size() + frames.size() < kMaxTraceEvents)
+        finishedProcesses.push_back(lastProcess);
+    else
+        droppedEvents++;
+}
+
+void Instrumentation::frameDamaged()
+{
+    if (frameOpen)
+        return;
+    frameOpen = true;
+    currentFrame = {nowUs(), 0, 0, 0};
+}
+
+void Instrumentation::frameFlushing()
+{
+    if (!frameOpen)
+        frameDamaged();
+    currentFrame.flushUs = nowUs();
+    bytesAtFlush = measuringTerminal() ? terminalBytesWritten() : 0;
+}
+
+void Instrumentation::frameDone()
+{
+    currentFrame.endUs = nowUs();
+    // Nothing else writes while doupdate runs, so the growth of the write counter is the frame
+    currentFrame.bytes = measuringTerminal() ? terminalBytesWritten() - bytesAtFlush : 0;
+    lastFrame = currentFrame;
+    frameOpen = false;
+
+    int64_t duration = currentFrame.endUs - currentFrame.startUs;
+    recentFrames.frames++;
+    recentFrames.totalUs += duration;
+    recentFrames.worstUs = std::max(recentFrames.worstUs, duration);
+    recentFrames.bytes += currentFrame.bytes;
+
+    if (!tracing())
+        return;
+    if (finishedProcesses.size() + frames.size() < kMaxTraceEvents)
+        frames.push_back(currentFrame);
+    else
+        droppedEvents++;
+}
+
+FrameStats Instrumentation::takeFrameStats()
+{
+    FrameStats stats = recentFrames;
+    recentFrames = {0, 0, 0, 0};
+    return stats;
+}
+
+size_t Instrumentation::terminalBytesWritten()
+{
+    if (ioFd < 0)
+    {
+        ioFd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+        if (ioFd < 0)
+            return 0;
+    }
+    char text[512];
+    ssize_t n = pread(ioFd, text, sizeof(text) - 1, 0);
+    if (n <= 0)
+        return 0;
+    text[n] = '\0';
+    const char *wchar = strstr(text, "wchar: ");
+    return wchar ? strtoull(wchar + 7, nullptr, 10) : 0;
+}
+
+bool Instrumentation::writeTrace()
+{
+    if (!tracing())
+        return false;
+
+    // Complete ("X") events: frames on one track, each child process on a track of its own
+    nlohmann::json events = nlohmann::json::array();
+    events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", 1}, {"args", {{"name", "gitNCurses"}}}});
+    events.push_back(
+        {{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", 0}, {"args", {{"name", "frames"}}}});
+    for (const FrameTiming &frame : frames)
+    {
+        events.push_back({{"name", "frame"},
+                          {"cat", "render"},
+                          {"ph", "X"},
+                          {"pid", 1},
+                          {"tid", 0},
+                          {"ts", frame.startUs},
+                          {"dur", frame.endUs - frame.startUs},
+                          {"args",
+                           {{"draw_us", frame.flushUs - frame.startUs},
+                            {"flush_us", frame.endUs - frame.flushUs},
+                            {"terminal_bytes", frame.bytes}}}});
+    }
+    for (const ProcessTiming &process : finishedProcesses)
+    {
+        events.push_back({{"name", process.command.substr(0, 80)},
+                          {"cat", "git"},
+                          {"ph", "X"},
+                          {"pid", 1},
+                          {"tid", process.pid},
+                          {"ts", process.startUs},
+                          {"dur", process.endUs - process.startUs},
+                          {"args",
+                           {{"argv", process.command},
+                            {"spawn_us", process.spawnUs},
+                            {"first_byte_us", process.firstByteUs},
+                            {"bytes", process.bytes},
+                            {"exit_code", process.exitCode}}}});
+    }
+
+    nlohmann::json trace = {
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"},
+        {"otherData", {{"processes_spawned", processesSpawned}, {"dropped_events", droppedEvents}}},
+    };
+    std::ofstream file(tracePath);
+    // Commands and branch names are not necessarily UTF-8; replace bad bytes rather than throw
+    file << trace.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << "\n";
+    return static_cast<bool>(file);
+}
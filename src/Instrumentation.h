@@ -0,0 +1,112 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// Timings of one child process, in microseconds since the session started
+struct ProcessTiming
+{
+    pid_t pid;
+    std::string command; // argv joined with spaces
+    int64_t startUs;
+    int64_t spawnUs;     // Spent in posix_spawn
+    int64_t firstByteUs; // From start to the first byte read, -1 before any output
+    int64_t endUs;       // Reaped, 0 while running
+    size_t bytes;        // Read from stdout and stderr
+    int exitCode;
+};
+
+// Timings of one frame: drawing into windows from the first damage, then the push to the terminal
+struct FrameTiming
+{
+    int64_t startUs;
+    int64_t flushUs; // update_panels + doupdate
+    int64_t endUs;
+    size_t bytes;    // Sent to the terminal, counted only while measuring
+};
+
+// Frames finished since the last takeFrameStats()
+struct FrameStats
+{
+    size_t frames;
+    int64_t totalUs;
+    int64_t worstUs;
+    size_t bytes;
+};
+
+// Lookups answered from a cache versus those that had to go back to git or the .git files
+struct CacheStats
+{
+    size_t hits;
+    size_t misses;
+};
+
+// Session-wide counters for every child process and every frame. Process
+// records come from ProcessRunner, which spawns and reaps all git commands,
+// synchronous or streamed; frame records come from ScreenRenderer::flush.
+// With GITNCURSES_TRACE=<file> each record is also kept as an event and the
+// whole session is written as Chrome trace-event JSON at exit, ready for
+// chrome://tracing or Perfetto.
+class Instrumentation
+{
+public:
+    static Instrumentation &instance();
+    // Microseconds since the session started
+    int64_t nowUs() const;
+
+    Instrumentation(const Instrumentation &) = delete;
+    Instrumentation &operator=(const Instrumentation &) = delete;
+
+    void processSpawned(pid_t pid, const std::vector<std::string> &argv, int64_t startUs);
+    void processOutput(pid_t pid, size_t bytes);
+    void processExited(pid_t pid, int exitCode);
+
+    void frameDamaged();
+    void frameFlushing();
+    void frameDone();
+
+    // Terminal bytes are read from the kernel's write counter, which costs two syscalls
+    // per frame; that is only paid while tracing or while someone asked for it
+    void setMeasuringTerminal(bool enabled) { measureRequested = enabled; }
+    bool measuringTerminal() const { return measureRequested || tracing(); }
+
+    size_t processCount() const { return processesSpawned; }
+    size_t runningCount() const { return running.size(); }
+    const ProcessTiming &lastFinishedProcess() const { return lastProcess; }
+    const FrameTiming &lastFinishedFrame() const { return lastFrame; }
+    FrameStats takeFrameStats();
+
+    bool tracing() const { return !tracePath.empty(); }
+    // Write the trace file; called at exit, and safe to call again
+    bool writeTrace();
+
+private:
+    Instrumentation();
+    ~Instrumentation();
+
+    int64_t sessionStart;
+    std::string tracePath;
+    bool measureRequested;
+    int ioFd; // /proc/self/io, opened on first use
+
+    std::unordered_map<pid_t, ProcessTiming> running;
+    std::vector<ProcessTiming> finishedProcesses; // Kept only while tracing
+    std::vector<FrameTiming> frames;              // Kept only while tracing
+    size_t droppedEvents;
+
+    size_t processesSpawned;
+    ProcessTiming lastProcess;
+    FrameTiming currentFrame;
+    FrameTiming lastFrame;
+    FrameStats recentFrames;
+    bool frameOpen;
+    size_t bytesAtFlush;
+
+    size_t terminalBytesWritten();
+};
+
+#endif // INSTRUMENTATION_H
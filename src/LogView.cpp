@@ -0,0 +1,243 @@
+#include "LogView.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Below this much packed history a full topological walk for --graph is quick anyway
+    const off_t kSmallRepoPackBytes = 4 * 1024 * 1024;
+
+    bool exists(const std::string &path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0;
+    }
+}
+
+LogView::LogView(const std::string &objectsDir, size_t capacity)
+    : graph(useGraph(objectsDir)), capacity(capacity), process{-1, -1, -1}, running(false), eof(false),
+      buffer(64 * 1024), skipRemaining(0), readLines(0), knownLines(0), wantedLines(0), windowStart(0)
+{
+    baseArgs = {"git", "log", "--oneline", "--all", "--color=never"};
+    if (graph)
+    {
+        baseArgs.push_back("--graph");
+    }
+    start(0);
+}
+
+LogView::~LogView()
+{
+    stop();
+}
+
+bool LogView::useGraph(const std::string &objectsDir)
+{
+    // --graph implies topological order; without commit-graph generation numbers git
+    // must walk the entire history before printing the first row
+    if (exists(objectsDir + "/info/commit-graph") || exists(objectsDir + "/info/commit-graphs/commit-graph-chain"))
+        return true;
+
+    off_t packBytes = 0;
+    DIR *d = opendir((objectsDir + "/pack").c_str());
+    if (!d)
+        return true;
+    while (dirent *entry = readdir(d))
+    {
+        size_t len = strlen(entry->d_name);
+        struct stat st;
+        if (len > 5 && strcmp(entry->d_name + len - 5, ".pack") == 0 &&
+            stat((objectsDir + "/pack/" + entry->d_name).c_str(), &st) == 0)
+        {
+            packBytes += st.st_size;
+        }
+    }
+    closedir(d);
+    return packBytes < kSmallRepoPackBytes;
+}
+
+void LogView::start(size_t skip)
+{
+    stop();
+    rows.clear();
+    partial.clear();
+    windowStart = skip;
+    skipRemaining = skip;
+    readLines = 0;
+    eof = false;
+    error.clear();
+    try
+    {
+        process = ProcessRunner::spawn(baseArgs, true);
+    }
+    catch (const std::exception &e)
+    {
+        rows.push_back(std::string("Error: ") + e.what());
+        knownLines = std::max(knownLines, windowStart + 1);
+        eof = true;
+        return;
+    }
+    fcntl(process.outFd, F_SETFL, fcntl(process.outFd, F_GETFL) | O_NONBLOCK);
+    fcntl(process.errFd, F_SETFL, fcntl(process.errFd, F_GETFL) | O_NONBLOCK);
+    running = true;
+}
+
+void LogView::stop()
+{
+    if (!running)
+        return;
+    // git may be blocked writing to the full pipe; it is not needed any more
+    kill(-process.pid, SIGTERM);
+    close(process.outFd);
+    close(process.errFd);
+    ProcessRunner::waitForExit(process.pid);
+    running = false;
+}
+
+void LogView::finish()
+{
+    // git closed its output, so it has exited or is about to; keep what it said on the way out
+    ssize_t n;
+    while ((n = read(process.errFd, buffer.data(), buffer.size())) > 0)
+    {
+        error.assign(buffer.data(), n);
+    }
+    close(process.outFd);
+    close(process.errFd);
+    int exitCode = ProcessRunner::waitForExit(process.pid);
+    running = false;
+    if (exitCode == 0)
+    {
+        error.clear();
+        return;
+    }
+    if (error.empty())
+        error = "git log exited with status " + std::to_string(exitCode);
+    if (rows.empty() && skipRemaining == 0)
+    {
+        // Nothing else to show: put everything git said in the body too
+        size_t start = 0;
+        while (start < error.size())
+        {
+            size_t end = std::min(error.find('\n', start), error.size());
+            rows.push_back(error.substr(start, end - start));
+            start = end + 1;
+        }
+        knownLines = std::max(knownLines, windowStart + rows.size());
+    }
+}
+
+std::string LogView::title() const
+{
+    std::string text = "log --all";
+    text += graph ? " --graph" : " (graph off: no commit-graph, run 'git commit-graph write')";
+    text += " - " + std::to_string(knownLines) + (eof ? " rows" : "+ rows");
+    if (!error.empty())
+        text += " - " + error.substr(0, error.find('\n'));
+    return text;
+}
+
+std::string_view LogView::line(size_t index) const
+{
+    // Rows outside the window are being re-read after a restart
+    if (index < windowStart || index >= windowStart + rows.size())
+        return std::string_view();
+    return rows[index - windowStart];
+}
+
+void LogView::prepare(size_t first, size_t count)
+{
+    if (first < windowStart)
+    {
+        // Scrolled above what is kept: re-run git and centre the window on the request
+        start(first > capacity / 2 ? first - capacity / 2 : 0);
+        wantedLines = 0;
+    }
+    // Read one page ahead so scrolling down rarely waits for git
+    wantedLines = std::max(wantedLines, first + 2 * count);
+}
+
+int LogView::fd() const
+{
+    if (!running || (skipRemaining == 0 && windowStart + rows.size() >= wantedLines))
+        return -1;
+    return process.outFd;
+}
+
+bool LogView::pump()
+{
+    if (!running)
+        return false;
+
+    // Drain stderr so git can never block on it, keeping the latest message
+    ssize_t n;
+    while ((n = read(process.errFd, buffer.data(), buffer.size())) > 0)
+    {
+        error.assign(buffer.data(), n);
+    }
+
+    size_t before = readLines;
+    for (int reads = 0; reads < 16 && fd() >= 0; reads++)
+    {
+        n = read(process.outFd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            break;
+        Instrumentation::instance().processOutput(process.pid, n);
+        if (n == 0)
+        {
+            if (!partial.empty())
+            {
+                addLine(std::move(partial));
+                partial.clear();
+            }
+            eof = true;
+            knownLines = readLines;
+            finish();
+            break;
+        }
+
+        const char *data = buffer.data();
+        const char *end = data + n;
+        while (data < end)
+        {
+            const char *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+            if (!newline)
+            {
+                partial.append(data, end - data);
+                break;
+            }
+            partial.append(data, newline - data);
+            addLine(std::move(partial));
+            partial.clear();
+            data = newline + 1;
+        }
+    }
+    return readLines != before || eof;
+}
+
+void LogView::addLine(std::string &&text)
+{
+    readLines++;
+    if (skipRemaining > 0)
+    {
+        skipRemaining--;
+        return;
+    }
+    rows.push_back(std::move(text));
+    if (rows.size() > capacity)
+    {
+        rows.pop_front();
+        windowStart++;
+    }
+    knownLines = std::max(knownLines, windowStart + rows.size());
+}
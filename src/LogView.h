@@ -0,0 +1,58 @@
+#ifndef LOG_VIEW_H
+#define LOG_VIEW_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "PaneView.h"
+#include "ProcessRunner.h"
+
+// Commit log read from one long-lived `git log` pipe, only as far as the
+// user has scrolled (plus a page of read-ahead). git blocks on the full pipe
+// in between, so opening the view costs one screen, not the whole history.
+// Only a bounded window of rows is kept; scrolling above it restarts git and
+// skips forward to the requested row.
+class LogView : public PaneView
+{
+public:
+    // objectsDir decides whether --graph can be afforded (see useGraph)
+    explicit LogView(const std::string &objectsDir, size_t capacity = 50000);
+    ~LogView() override;
+
+    LogView(const LogView &) = delete;
+    LogView &operator=(const LogView &) = delete;
+
+    std::string title() const override;
+    size_t lineCount() const override { return knownLines; }
+    std::string_view line(size_t index) const override;
+    void prepare(size_t first, size_t count) override;
+    int fd() const override;
+    bool pump() override;
+    void loadAll() override { wantedLines = SIZE_MAX; }
+
+private:
+    std::vector<std::string> baseArgs;
+    bool graph;
+    size_t capacity;
+
+    SpawnedProcess process;
+    bool running;
+    bool eof;
+    std::vector<char> buffer;
+    std::string partial;     // Bytes of a line whose newline has not arrived yet
+    size_t skipRemaining;    // Lines still to discard after a restart
+    size_t readLines;        // Lines git has produced so far in this run
+    size_t knownLines;       // Highest row count ever seen, rows can be missing from the window
+    size_t wantedLines;      // Stop reading once this many rows exist
+    size_t windowStart;      // Row number of rows.front()
+    std::deque<std::string> rows;
+    std::string error;       // Last stderr of git, or its exit status when it failed silently
+
+    static bool useGraph(const std::string &objectsDir);
+    void start(size_t skip);
+    void stop();
+    void finish();
+    void addLine(std::string &&text);
+};
+
+#endif // LOG_VIEW_H
@@ -0,0 +1,226 @@
+#include "OutputBuffer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+OutputBuffer::OutputBuffer(size_t chunkSize, size_t memoryLimit)
+    : chunkSize(chunkSize), memoryLimit(memoryLimit), resident(0), usedChunks(0), openLine(false), lastChunk(0),
+      spillFd(-1), spillBytes(0), firstResident(0)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    releaseSpill();
+    if (spillFd >= 0)
+        close(spillFd);
+}
+
+void OutputBuffer::clear()
+{
+    releaseSpill();
+    // Keep one chunk and the index capacity for the next command; a large
+    // output does not leave the rest of its chunks behind
+    if (chunks.size() > 1)
+        chunks.resize(1);
+    if (!chunks.empty() && chunks[0].bytes.capacity() > chunkSize)
+        std::string().swap(chunks[0].bytes);
+    resident = chunks.empty() ? 0 : chunks[0].bytes.capacity();
+    usedChunks = 0;
+    lineStarts.clear();
+    openLine = false;
+    lastChunk = 0;
+    firstResident = 0;
+}
+
+void OutputBuffer::setMemoryLimit(size_t bytes)
+{
+    memoryLimit = bytes;
+    enforceLimit();
+}
+
+void OutputBuffer::append(const char *data, size_t size)
+{
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+        appendToOpenLine(data, (newline ? newline : end) - data);
+        if (!newline)
+            break;
+
+        openLine = false;
+        data = newline + 1;
+    }
+    enforceLimit();
+}
+
+size_t OutputBuffer::chunkOf(size_t index) const
+{
+    auto starts = [&](size_t chunk) { return chunks[chunk].firstLine; };
+    if (lastChunk < usedChunks && starts(lastChunk) <= index &&
+        (lastChunk + 1 == usedChunks || index < starts(lastChunk + 1)))
+        return lastChunk;
+
+    auto found = std::upper_bound(chunks.begin(), chunks.begin() + usedChunks, index,
+                                  [](size_t line, const Chunk &chunk) { return line < chunk.firstLine; });
+    lastChunk = static_cast<size_t>(found - chunks.begin()) - 1;
+    return lastChunk;
+}
+
+std::string_view OutputBuffer::line(size_t index) const
+{
+    size_t chunk = chunkOf(index);
+    size_t start = lineStarts[index];
+    size_t end = chunks[chunk].size();
+    if (chunk + 1 == usedChunks ? index + 1 < lineStarts.size() : index + 1 < chunks[chunk + 1].firstLine)
+        end = lineStarts[index + 1];
+    return std::string_view(chunks[chunk].data() + start, end - start);
+}
+
+size_t OutputBuffer::startChunk(size_t firstLine, size_t capacity)
+{
+    if (usedChunks == chunks.size())
+        chunks.push_back({std::string(), nullptr, 0, 0});
+
+    // Reuse a chunk kept by clear() when there is one
+    Chunk &chunk = chunks[usedChunks];
+    chunk.bytes.clear();
+    chunk.mapped = nullptr;
+    chunk.mappedLength = 0;
+    chunk.firstLine = firstLine;
+    resident -= chunk.bytes.capacity();
+    chunk.bytes.reserve(capacity);
+    resident += chunk.bytes.capacity();
+    return usedChunks++;
+}
+
+void OutputBuffer::appendToOpenLine(const char *data, size_t size)
+{
+    // Offsets are 32-bit, so only a single huge line may take a chunk past 4 GiB
+    if (usedChunks == 0 || chunks[usedChunks - 1].mapped ||
+        (!openLine && chunks[usedChunks - 1].bytes.size() > UINT32_MAX))
+        startChunk(lineStarts.size(), chunkSize);
+    if (!openLine)
+    {
+        lineStarts.push_back(static_cast<uint32_t>(chunks[usedChunks - 1].bytes.size()));
+        openLine = true;
+    }
+
+    std::string *chunk = &chunks[usedChunks - 1].bytes;
+    size_t offset = lineStarts.back();
+    size_t length = chunk->size() - offset;
+    if (chunk->size() + size > chunk->capacity() && offset == 0)
+    {
+        // A single line larger than a chunk gets its own growing chunk
+        resident -= chunk->capacity();
+        chunk->reserve(std::max(chunk->capacity() * 2, length + size));
+        resident += chunk->capacity();
+    }
+    else if (chunk->size() + size > chunk->capacity())
+    {
+        // Move the unfinished line into a fresh chunk so every line stays contiguous
+        size_t fresh = startChunk(lineStarts.size() - 1, std::max(chunkSize, length + size));
+        std::string &previous = chunks[fresh - 1].bytes;
+        chunk = &chunks[fresh].bytes;
+        chunk->append(previous, offset, length);
+        previous.resize(offset);
+        lineStarts.back() = 0;
+    }
+
+    chunk->append(data, size);
+}
+
+void OutputBuffer::enforceLimit()
+{
+    // The last chunk is still being filled and always stays in memory
+    while (resident > memoryLimit && firstResident + 1 < usedChunks)
+    {
+        if (!spill(chunks[firstResident]))
+            return;
+        firstResident++;
+    }
+}
+
+void OutputBuffer::spillAll()
+{
+    size_t keep = openLine ? 1 : 0;
+    while (firstResident + keep < usedChunks)
+    {
+        if (!spill(chunks[firstResident]))
+            return;
+        firstResident++;
+    }
+}
+
+bool OutputBuffer::spill(Chunk &chunk)
+{
+    if (spillFd < 0)
+    {
+        const char *tmp = getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/gitncurses-output-XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        spillFd = mkostemp(name.data(), O_CLOEXEC);
+        if (spillFd < 0)
+            return false; // No spill space: keep everything in memory
+        unlink(name.data());
+    }
+
+    size_t length = chunk.bytes.size();
+    if (length > 0)
+    {
+        for (size_t written = 0; written < length;)
+        {
+            ssize_t n = pwrite(spillFd, chunk.bytes.data() + written, length - written, spillBytes + written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            written += n;
+        }
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, spillFd, spillBytes);
+        if (mapped == MAP_FAILED)
+            return false;
+        chunk.mapped = static_cast<const char *>(mapped);
+        chunk.mappedLength = length;
+
+        // mmap offsets must be page aligned
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        spillBytes += (length + page - 1) / page * page;
+    }
+    else
+    {
+        chunk.mapped = "";
+    }
+
+    resident -= chunk.bytes.capacity();
+    std::string().swap(chunk.bytes);
+    return true;
+}
+
+void OutputBuffer::releaseSpill()
+{
+    for (size_t i = 0; i < firstResident; i++)
+    {
+        Chunk &chunk = chunks[i];
+        if (chunk.mappedLength)
+            munmap(const_cast<char *>(chunk.mapped), chunk.mappedLength);
+        chunk.mapped = nullptr;
+        chunk.mappedLength = 0;
+    }
+    if (spillFd >= 0 && spillBytes > 0)
+    {
+        // Give the disk space back but keep the file for the next spill
+        if (ftruncate(spillFd, 0) != 0)
+        {
+            close(spillFd);
+            spillFd = -1;
+        }
+    }
+    spillBytes = 0;
+}
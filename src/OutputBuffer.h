@@ -0,0 +1,75 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Append-only store for command output. Bytes go into large chunks as they
+// arrive and a newline index is extended incrementally, so the first screen
+// can be drawn from the first chunk and no line is ever copied twice.
+// Once the chunks in memory exceed the memory limit, the oldest complete
+// chunks are written to an unlinked temporary file and read back through
+// mmap, where the kernel can drop them whenever it needs the memory.
+// Each line costs four bytes of index: its offset within its chunk. The chunk
+// is found from the first line of each chunk and the line ends where the next
+// one starts, so clear() only resets counts and keeps the allocations.
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(size_t chunkSize = 256 * 1024, size_t memoryLimit = SIZE_MAX);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void clear();
+    void append(const char *data, size_t size);
+    void append(const std::string &text) { append(text.data(), text.size()); }
+
+    // Number of lines, counting a trailing line that has no newline yet
+    size_t lineCount() const { return lineStarts.size(); }
+    std::string_view line(size_t index) const;
+
+    void setMemoryLimit(size_t bytes);
+    // Chunk bytes held in memory rather than in the spill file
+    size_t residentBytes() const { return resident; }
+    size_t indexBytes() const { return lineStarts.capacity() * sizeof(uint32_t); }
+    // Move every finished chunk to the spill file, e.g. once the output is only kept for history
+    void spillAll();
+
+private:
+    struct Chunk
+    {
+        std::string bytes;    // Empty once spilled
+        const char *mapped;   // Spilled bytes, nullptr while in memory
+        size_t mappedLength;
+        size_t firstLine;     // Index of the first line stored here
+
+        const char *data() const { return mapped ? mapped : bytes.data(); }
+        size_t size() const { return mapped ? mappedLength : bytes.size(); }
+    };
+
+    size_t chunkSize;
+    size_t memoryLimit;
+    size_t resident;
+    std::vector<Chunk> chunks; // Every line lies entirely within one chunk; kept across clear()
+    size_t usedChunks;         // chunks past this one are spare allocations
+    std::vector<uint32_t> lineStarts; // Offset of each line within its chunk
+    bool openLine; // The last line has not seen its newline yet
+    mutable size_t lastChunk; // Chunk of the last line looked up; rows are read in order
+
+    int spillFd;        // Created on first spill, reused after clear()
+    size_t spillBytes;  // End of the spill file, page aligned
+    size_t firstResident; // Chunks before this one are spilled
+
+    size_t startChunk(size_t firstLine, size_t capacity);
+    size_t chunkOf(size_t index) const;
+    void appendToOpenLine(const char *data, size_t size);
+    void enforceLimit();
+    bool spill(Chunk &chunk);
+    void releaseSpill();
+};
+
+#endif // OUTPUT_BUFFER_H
@@ -0,0 +1,59 @@
+#ifndef PANE_VIEW_H
+#define PANE_VIEW_H
+
+#include <string>
+#include <string_view>
+#include "RepoWatcher.h"
+
+// Content for the output pane that is produced lazily instead of being
+// collected up front. The pane asks only for the rows it is about to draw;
+// views that read from a long-lived git process expose its pipe so the
+// event loop can wake them while more rows are wanted.
+class PaneView
+{
+public:
+    // How a row should be coloured; the pane maps these to colour pairs
+    enum class LineStyle
+    {
+        Plain,
+        Header,
+        Hunk,
+        Added,
+        Removed,
+        Note
+    };
+
+    virtual ~PaneView() {}
+
+    // Shown in the pane's top border
+    virtual std::string title() const = 0;
+
+    // Rows known so far; grows while the view is loading
+    virtual size_t lineCount() const = 0;
+    virtual std::string_view line(size_t index) const = 0;
+    virtual LineStyle lineStyle(size_t index) const { return LineStyle::Plain; }
+
+    // The pane is about to show rows [first, first + count); load them and a little beyond
+    virtual void prepare(size_t first, size_t count) = 0;
+
+    // Pipe to watch while the view still wants input, -1 otherwise
+    virtual int fd() const { return -1; }
+
+    // Read what fd() has available; returns true when rows were added
+    virtual bool pump() { return false; }
+
+    // Keep loading until the source is exhausted (jump to end)
+    virtual void loadAll() {}
+
+    // Views whose rows can be acted on get a cursor row in the pane
+    virtual bool hasCursor() const { return false; }
+
+    // A key pressed while the view is shown; returns true when it was consumed.
+    // The view may move the cursor, e.g. to jump to the next section.
+    virtual bool handleKey(int ch, size_t &cursor) { return false; }
+
+    // The repository changed on disk while the view was shown
+    virtual void repoChanged(const RepoChanges &changes) {}
+};
+
+#endif // PANE_VIEW_H
@@ -0,0 +1,158 @@
+#include "PerformanceHud.h"
+#include <algorithm>
+#include <cstdio>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "ScreenRenderer.h"
+
+namespace
+{
+    const long kIntervalMs = 500;
+    const int kWidth = 60;
+
+    std::string formatMs(int64_t us)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.1f ms", us / 1000.0);
+        return text;
+    }
+
+    std::string formatBytes(size_t bytes)
+    {
+        char text[32];
+        if (bytes >= (1u << 20))
+            snprintf(text, sizeof(text), "%.1f MB", bytes / 1048576.0);
+        else if (bytes >= 1024)
+            snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+        else
+            snprintf(text, sizeof(text), "%zu B", bytes);
+        return text;
+    }
+
+    std::string formatRate(const CacheStats &stats)
+    {
+        size_t total = stats.hits + stats.misses;
+        if (total == 0)
+            return "-";
+        return std::to_string(stats.hits * 100 / total) + "% of " + std::to_string(total);
+    }
+}
+
+PerformanceHud::PerformanceHud()
+    : win(nullptr), tickFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)), hasCommand(false),
+      lastCommand{-1, "", 0, 0, -1, 0, 0, 0}, frames{0, 0, 0, 0}
+{
+}
+
+PerformanceHud::~PerformanceHud()
+{
+    hide();
+    if (tickFd >= 0)
+        close(tickFd);
+}
+
+void PerformanceHud::show(WINDOW *area)
+{
+    hide();
+    int areaY, areaX, areaHeight, areaWidth;
+    getbegyx(area, areaY, areaX);
+    getmaxyx(area, areaHeight, areaWidth);
+    int width = std::min(kWidth, areaWidth - 2);
+    int height = std::min(9, areaHeight - 2);
+    if (width < 20 || height < 3)
+        return;
+    win = newwin(height, width, areaY + 1, areaX + areaWidth - width - 1);
+    drawnRows.clear();
+
+    // Start from a clean interval and let the renderer count terminal bytes
+    Instrumentation &instrumentation = Instrumentation::instance();
+    instrumentation.takeFrameStats();
+    instrumentation.setMeasuringTerminal(true);
+    frames = {0, 0, 0, 0};
+
+    itimerspec spec = {};
+    spec.it_value.tv_nsec = kIntervalMs * 1000000;
+    spec.it_interval = spec.it_value;
+    timerfd_settime(tickFd, 0, &spec, nullptr);
+}
+
+void PerformanceHud::hide()
+{
+    if (!win)
+        return;
+    itimerspec spec = {};
+    timerfd_settime(tickFd, 0, &spec, nullptr);
+    Instrumentation::instance().setMeasuringTerminal(false);
+    delwin(win);
+    win = nullptr;
+}
+
+void PerformanceHud::takeTick()
+{
+    uint64_t expirations;
+    ssize_t ignored = read(tickFd, &expirations, sizeof(expirations));
+    (void)ignored;
+}
+
+void PerformanceHud::commandFinished(const ProcessTiming &timing)
+{
+    lastCommand = timing;
+    hasCommand = true;
+}
+
+bool PerformanceHud::update(const HudInputs &inputs)
+{
+    if (!win)
+        return false;
+
+    // An idle interval keeps the previous figures, otherwise the HUD's own repaint would be all it shows
+    Instrumentation &instrumentation = Instrumentation::instance();
+    FrameStats recent = instrumentation.takeFrameStats();
+    if (recent.frames > 0)
+        frames = recent;
+
+    std::vector<std::string> rows;
+    if (frames.frames > 0)
+    {
+        rows.push_back("frames  " + std::to_string(frames.frames) + ", avg " +
+                       formatMs(frames.totalUs / static_cast<int64_t>(frames.frames)) + ", worst " +
+                       formatMs(frames.worstUs) + ", " + formatBytes(frames.bytes));
+    }
+    else
+    {
+        rows.push_back("frames  -");
+    }
+    rows.push_back("git     " + std::to_string(instrumentation.processCount()) + " spawned, " +
+                   std::to_string(instrumentation.runningCount()) + " running");
+    rows.push_back("cache   branches " + formatRate(inputs.branches) + ", status " + formatRate(inputs.repoState));
+    rows.push_back("output  " + formatBytes(inputs.outputBytes) + " in memory, " +
+                   std::to_string(inputs.outputBuffers) + " buffers");
+    if (hasCommand)
+    {
+        const ProcessTiming &command = lastCommand;
+        rows.push_back("last    " + command.command);
+        rows.push_back("        spawn " + formatMs(command.spawnUs) + ", first byte " +
+                       (command.firstByteUs < 0 ? std::string("-") : formatMs(command.firstByteUs)) + ", total " +
+                       formatMs(command.endUs - command.startUs));
+        rows.push_back("        " + formatBytes(command.bytes) + " read, exit " + std::to_string(command.exitCode));
+    }
+    else
+    {
+        rows.push_back("last    -");
+    }
+
+    if (rows == drawnRows)
+        return false;
+    drawnRows = rows;
+
+    int height = getmaxy(win);
+    int width = getmaxx(win);
+    werase(win);
+    box(win, 0, 0);
+    mvwprintw(win, 0, 2, " Performance ");
+    for (int i = 0; i < static_cast<int>(rows.size()) && i < height - 2; i++)
+    {
+        ScreenRenderer::drawLine(win, i + 1, 1, rows[i], width - 2);
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef PERFORMANCE_HUD_H
+#define PERFORMANCE_HUD_H
+
+#include <ncurses.h>
+#include <string>
+#include <vector>
+#include "Instrumentation.h"
+
+// Figures only the application can collect, passed in on every update
+struct HudInputs
+{
+    CacheStats branches;
+    CacheStats repoState;
+    size_t outputBytes;   // Output chunks and line indexes held in memory
+    size_t outputBuffers; // The live output plus the kept history
+};
+
+// Live performance overlay in the top right corner of the output window:
+// frame times, git processes, cache hit rates, output memory and the latency
+// of the last command. It refreshes on its own timer, at most a few times a
+// second, and only repaints when a figure changed, so an open HUD costs
+// little. Terminal bytes are measured only while it is shown.
+class PerformanceHud
+{
+public:
+    PerformanceHud();
+    ~PerformanceHud();
+
+    PerformanceHud(const PerformanceHud &) = delete;
+    PerformanceHud &operator=(const PerformanceHud &) = delete;
+
+    // Create the window over area's top right corner; hide before the window is reused
+    void show(WINDOW *area);
+    void hide();
+    bool isVisible() const { return win != nullptr; }
+    WINDOW *window() const { return win; }
+
+    // Readable once per update interval while the HUD is shown
+    int timerFd() const { return tickFd; }
+    void takeTick();
+
+    // Keep the breakdown of a command the user ran, taken right after it was reaped
+    void commandFinished(const ProcessTiming &timing);
+
+    // Returns true when the contents changed and the window needs a frame
+    bool update(const HudInputs &inputs);
+
+private:
+    WINDOW *win;
+    int tickFd;
+    bool hasCommand;
+    ProcessTiming lastCommand;
+    FrameStats frames; // From the last interval that drew anything
+    std::vector<std::string> drawnRows;
+};
+
+#endif // PERFORMANCE_HUD_H
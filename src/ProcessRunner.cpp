@@ -0,0 +1,256 @@
+#include "ProcessRunner.h"
+#include "Instrumentation.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <csignal>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+ProcessRunner::ProcessRunner(size_t bufferSize)
+    : buffer(bufferSize)
+{
+}
+
+SpawnedProcess ProcessRunner::spawn(const std::vector<std::string> &argv, bool ownProcessGroup, bool withInput)
+{
+    if (argv.empty())
+    {
+        throw std::runtime_error("No command given");
+    }
+
+    Instrumentation &instrumentation = Instrumentation::instance();
+    int64_t startUs = instrumentation.nowUs();
+    int outPipe[2];
+    int errPipe[2] = {-1, -1};
+    int inPipe[2] = {-1, -1};
+    if (pipe2(outPipe, O_CLOEXEC) != 0)
+    {
+        throw std::runtime_error(std::string("pipe() failed: ") + strerror(errno));
+    }
+    if (pipe2(errPipe, O_CLOEXEC) != 0 || (withInput && pipe2(inPipe, O_CLOEXEC) != 0))
+    {
+        int error = errno;
+        for (int fd : {outPipe[0], outPipe[1], errPipe[0], errPipe[1]})
+            close(fd);
+        throw std::runtime_error(std::string("pipe() failed: ") + strerror(error));
+    }
+
+    // Child gets /dev/null on stdin so it can never steal keystrokes from ncurses
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (withInput)
+        posix_spawn_file_actions_adddup2(&actions, inPipe[0], STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+
+    // We ignore SIGPIPE to survive a child that stops reading its input; the child must not inherit that
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    short flags = POSIX_SPAWN_SETSIGDEF;
+
+    // A separate process group lets a cancel reach git's own children (ssh, hooks)
+    if (ownProcessGroup)
+    {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    std::vector<char *> args;
+    args.reserve(argv.size() + 1);
+    for (const auto &arg : argv)
+    {
+        args.push_back(const_cast<char *>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    pid_t pid;
+    int spawnError = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(outPipe[1]);
+    close(errPipe[1]);
+    if (withInput)
+        close(inPipe[0]);
+
+    if (spawnError != 0)
+    {
+        close(outPipe[0]);
+        close(errPipe[0]);
+        if (withInput)
+            close(inPipe[1]);
+        throw std::runtime_error(std::string("posix_spawn() failed: ") + strerror(spawnError));
+    }
+
+    instrumentation.processSpawned(pid, argv, startUs);
+    return {pid, outPipe[0], errPipe[0], inPipe[1]};
+}
+
+int ProcessRunner::waitForExit(pid_t pid)
+{
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    int exitCode = -1;
+    if (WIFEXITED(status))
+        exitCode = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+        exitCode = 128 + WTERMSIG(status);
+    Instrumentation::instance().processExited(pid, exitCode);
+    return exitCode;
+}
+
+ProcessResult ProcessRunner::run(const std::vector<std::string> &argv, size_t maxOutput)
+{
+    return collect(spawn(argv), maxOutput, std::string_view());
+}
+
+ProcessResult ProcessRunner::runWithInput(const std::vector<std::string> &argv, std::string_view input)
+{
+    SpawnedProcess process = spawn(argv, false, true);
+    fcntl(process.inFd, F_SETFL, fcntl(process.inFd, F_GETFL) | O_NONBLOCK);
+    return collect(process, SIZE_MAX, input);
+}
+
+ProcessResult ProcessRunner::collect(const SpawnedProcess &process, size_t maxOutput, std::string_view input)
+{
+    ProcessResult result{0, "", "", false};
+    pollfd fds[3] = {{process.outFd, POLLIN, 0}, {process.errFd, POLLIN, 0}, {process.inFd, POLLOUT, 0}};
+    std::string *targets[2] = {&result.output, &result.error};
+    int open = 2;
+
+    // Input is fed as the pipe drains; writing it all up front could deadlock against a child blocked on output
+    if (fds[2].fd >= 0 && input.empty())
+    {
+        close(fds[2].fd);
+        fds[2].fd = -1;
+    }
+
+    while (open > 0)
+    {
+        if (poll(fds, 3, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[2].fd >= 0 && fds[2].revents)
+        {
+            ssize_t n = write(fds[2].fd, input.data(), input.size());
+            if (n > 0)
+                input.remove_prefix(n);
+            if (input.empty() || (n < 0 && errno != EINTR && errno != EAGAIN))
+            {
+                // Done, or the child stopped reading; closing signals end of input
+                close(fds[2].fd);
+                fds[2].fd = -1;
+            }
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            if (fds[i].fd < 0 || fds[i].revents == 0)
+                continue;
+
+            ssize_t n = read(fds[i].fd, buffer.data(), buffer.size());
+            if (n > 0)
+            {
+                Instrumentation::instance().processOutput(process.pid, n);
+                targets[i]->append(buffer.data(), n);
+                if (i == 0 && result.output.size() >= maxOutput)
+                {
+                    // The caller has seen enough, don't pay for the rest of the output
+                    result.output.resize(maxOutput);
+                    result.truncated = true;
+                    kill(process.pid, SIGTERM);
+                    open = 0;
+                    break;
+                }
+            }
+            else if (n == 0 || errno != EINTR)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                open--;
+            }
+        }
+    }
+    for (const auto &fd : fds)
+    {
+        if (fd.fd >= 0)
+            close(fd.fd);
+    }
+
+    result.exitCode = waitForExit(process.pid);
+    return result;
+}
+
+std::vector<std::string> ProcessRunner::splitArgs(const std::string &commandLine)
+{
+    std::vector<std::string> args;
+    std::string current;
+    bool inArg = false;
+    char quote = 0;
+
+    for (size_t i = 0; i < commandLine.size(); i++)
+    {
+        char c = commandLine[i];
+        if (quote)
+        {
+            if (c == quote)
+            {
+                quote = 0;
+            }
+            else if (c == '\\' && quote == '"' && i + 1 < commandLine.size() &&
+                     (commandLine[i + 1] == '"' || commandLine[i + 1] == '\\'))
+            {
+                current += commandLine[++i];
+            }
+            else
+            {
+                current += c;
+            }
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+            inArg = true;
+        }
+        else if (c == '\\' && i + 1 < commandLine.size())
+        {
+            current += commandLine[++i];
+            inArg = true;
+        }
+        else if (isspace(static_cast<unsigned char>(c)))
+        {
+            if (inArg)
+            {
+                args.push_back(current);
+                current.clear();
+                inArg = false;
+            }
+        }
+        else
+        {
+            current += c;
+            inArg = true;
+        }
+    }
+    if (inArg)
+    {
+        args.push_back(current);
+    }
+    return args;
+}
@@ -0,0 +1,55 @@
+#ifndef PROCESS_RUNNER_H
+#define PROCESS_RUNNER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+struct ProcessResult
+{
+    int exitCode;
+    std::string output; // Captured stdout
+    std::string error;  // Captured stderr
+    bool truncated;     // Stopped early after maxOutput bytes; the child was terminated
+};
+
+struct SpawnedProcess
+{
+    pid_t pid;
+    int outFd; // Read end of the child's stdout
+    int errFd; // Read end of the child's stderr
+    int inFd = -1; // Write end of the child's stdin when requested, -1 otherwise
+};
+
+class ProcessRunner
+{
+public:
+    explicit ProcessRunner(size_t bufferSize = 64 * 1024);
+
+    // Spawn argv[0] (looked up in PATH) without a shell and wait for it to exit.
+    // Once maxOutput bytes of stdout have arrived the child is terminated and reading stops.
+    ProcessResult run(const std::vector<std::string> &argv, size_t maxOutput = SIZE_MAX);
+
+    // Like run(), but input is written to the child's stdin while its output is collected
+    ProcessResult runWithInput(const std::vector<std::string> &argv, std::string_view input);
+
+    // Spawn argv with stdout/stderr connected to fresh pipes; the caller owns the fds and must reap pid.
+    // stdin is /dev/null unless withInput, which connects it to inFd.
+    static SpawnedProcess spawn(const std::vector<std::string> &argv, bool ownProcessGroup = false,
+                                bool withInput = false);
+
+    // Block until pid exits and translate its status into an exit code (128 + signal when killed)
+    static int waitForExit(pid_t pid);
+
+    // Split a command line into arguments, honouring quotes and backslashes
+    static std::vector<std::string> splitArgs(const std::string &commandLine);
+
+private:
+    std::vector<char> buffer; // Reused for every read() across runs
+
+    ProcessResult collect(const SpawnedProcess &process, size_t maxOutput, std::string_view input);
+};
+
+#endif // PROCESS_RUNNER_H
@@ -0,0 +1,235 @@
+#include "RefReader.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace
+{
+    bool isDirectory(const std::string &path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    bool isFile(const std::string &path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+
+    std::string trim(const std::string &text)
+    {
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return end == std::string::npos ? "" : text.substr(0, end + 1);
+    }
+
+    std::string resolvePath(const std::string &base, const std::string &path)
+    {
+        std::string joined = (!path.empty() && path[0] == '/') ? path : base + "/" + path;
+        char resolved[PATH_MAX];
+        return realpath(joined.c_str(), resolved) ? std::string(resolved) : joined;
+    }
+
+    const std::string kHeadsPrefix = "refs/heads/";
+}
+
+RefReader::RefReader()
+    : opened(false)
+{
+}
+
+bool RefReader::open(const std::string &startDir)
+{
+    opened = false;
+
+    // An explicit GIT_DIR changes discovery rules, leave that to git itself
+    if (getenv("GIT_DIR"))
+        return false;
+
+    char resolved[PATH_MAX];
+    if (!realpath(startDir.c_str(), resolved))
+        return false;
+    std::string dir = resolved;
+
+    while (true)
+    {
+        std::string dotGit = dir + "/.git";
+        if (isDirectory(dotGit))
+        {
+            gitDirPath = dotGit;
+            break;
+        }
+        if (isFile(dotGit))
+        {
+            // Linked worktrees and submodules: ".git" is a file with "gitdir: <path>"
+            std::string contents;
+            if (!readFile(dotGit, contents) || contents.compare(0, 8, "gitdir: ") != 0)
+                return false;
+            gitDirPath = resolvePath(dir, trim(contents.substr(8)));
+            break;
+        }
+        if (dir == "/")
+            return false;
+        size_t slash = dir.find_last_of('/');
+        dir = slash == 0 ? "/" : dir.substr(0, slash);
+    }
+
+    commonDirPath = gitDirPath;
+    std::string commonDir;
+    if (readFile(gitDirPath + "/commondir", commonDir))
+    {
+        commonDirPath = resolvePath(gitDirPath, trim(commonDir));
+    }
+
+    // reftable repositories keep refs in a binary format we do not parse
+    if (isDirectory(commonDirPath + "/reftable") || !isFile(gitDirPath + "/HEAD"))
+        return false;
+
+    opened = true;
+    return true;
+}
+
+bool RefReader::readHead(std::string &branch, bool &detached) const
+{
+    if (!opened)
+        return false;
+
+    std::string contents;
+    if (!readFile(gitDirPath + "/HEAD", contents))
+        return false;
+    contents = trim(contents);
+
+    if (contents.compare(0, 5, "ref: ") == 0)
+    {
+        std::string target = contents.substr(5);
+        detached = false;
+        branch = target.compare(0, kHeadsPrefix.size(), kHeadsPrefix) == 0
+                     ? target.substr(kHeadsPrefix.size())
+                     : target;
+        return true;
+    }
+
+    detached = true;
+    branch.clear();
+    return !contents.empty();
+}
+
+bool RefReader::readHeadCommit(std::string &oid) const
+{
+    if (!opened)
+        return false;
+
+    std::string contents;
+    if (!readFile(gitDirPath + "/HEAD", contents))
+        return false;
+    contents = trim(contents);
+    if (contents.compare(0, 5, "ref: ") != 0)
+    {
+        oid = contents;
+        return !oid.empty();
+    }
+
+    std::string target = contents.substr(5);
+    if (target.compare(0, kHeadsPrefix.size(), kHeadsPrefix) != 0)
+        return false;
+    if (readFile(commonDirPath + "/" + target, contents))
+    {
+        // A symbolic ref chain is left to git
+        oid = trim(contents);
+        return !oid.empty() && oid.compare(0, 5, "ref: ") != 0;
+    }
+
+    std::ifstream packed(commonDirPath + "/packed-refs");
+    std::string line;
+    while (std::getline(packed, line))
+    {
+        size_t space = line.find(' ');
+        if (line.empty() || line[0] == '#' || line[0] == '^' || space == std::string::npos)
+            continue;
+        if (trim(line.substr(space + 1)) == target)
+        {
+            oid = line.substr(0, space);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RefReader::readLocalBranches(std::vector<std::string> &branches) const
+{
+    if (!opened)
+        return false;
+
+    std::vector<std::string> names;
+    collectLooseRefs(commonDirPath + "/refs/heads", "", names);
+
+    // packed-refs: "<oid> <refname>" lines, plus "#" headers and "^<oid>" peeled tag lines
+    std::ifstream packed(commonDirPath + "/packed-refs");
+    std::string line;
+    while (std::getline(packed, line))
+    {
+        if (line.empty() || line[0] == '#' || line[0] == '^')
+            continue;
+        size_t space = line.find(' ');
+        if (space == std::string::npos)
+            continue;
+        if (line.compare(space + 1, kHeadsPrefix.size(), kHeadsPrefix) == 0)
+        {
+            names.push_back(trim(line.substr(space + 1 + kHeadsPrefix.size())));
+        }
+    }
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    branches.swap(names);
+    return true;
+}
+
+bool RefReader::hasLooseBranch(const std::string &name) const
+{
+    return opened && isFile(commonDirPath + "/refs/heads/" + name);
+}
+
+bool RefReader::readFile(const std::string &path, std::string &contents)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::ostringstream oss;
+    oss << file.rdbuf();
+    contents = oss.str();
+    return true;
+}
+
+void RefReader::collectLooseRefs(const std::string &dir, const std::string &prefix, std::vector<std::string> &names)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    while (dirent *entry = readdir(d))
+    {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            continue;
+
+        std::string path = dir + "/" + name;
+        bool directory = entry->d_type == DT_DIR || (entry->d_type == DT_UNKNOWN && isDirectory(path));
+        if (directory)
+        {
+            collectLooseRefs(path, prefix + name + "/", names);
+            continue;
+        }
+
+        // Skip in-flight updates ("<ref>.lock")
+        size_t len = strlen(name);
+        if (len > 5 && strcmp(name + len - 5, ".lock") == 0)
+            continue;
+        names.push_back(prefix + name);
+    }
+    closedir(d);
+}
@@ -0,0 +1,43 @@
+#ifndef REF_READER_H
+#define REF_READER_H
+
+#include <string>
+#include <vector>
+
+// Reads HEAD and local branches straight from the files git keeps them in
+// (.git/HEAD, refs/heads/* and packed-refs), following worktree gitdir and
+// commondir indirection. Callers fall back to running git when a read fails.
+class RefReader
+{
+public:
+    RefReader();
+
+    // Locate the repository containing startDir; false when none is found or the layout is unsupported
+    bool open(const std::string &startDir = ".");
+    bool isOpen() const { return opened; }
+
+    const std::string &gitDir() const { return gitDirPath; }
+    const std::string &commonDir() const { return commonDirPath; }
+
+    // Branch HEAD points at, or detached = true when HEAD holds a commit id
+    bool readHead(std::string &branch, bool &detached) const;
+
+    // Commit id HEAD resolves to through a loose or packed branch; false for an unborn branch or anything unusual
+    bool readHeadCommit(std::string &oid) const;
+
+    // Sorted short names of all local branches, loose refs merged with packed-refs
+    bool readLocalBranches(std::vector<std::string> &branches) const;
+
+    // Whether refs/heads/<name> exists as a loose ref file
+    bool hasLooseBranch(const std::string &name) const;
+
+private:
+    bool opened;
+    std::string gitDirPath;
+    std::string commonDirPath;
+
+    static bool readFile(const std::string &path, std::string &contents);
+    static void collectLooseRefs(const std::string &dir, const std::string &prefix, std::vector<std::string> &names);
+};
+
+#endif // REF_READER_H
@@ -0,0 +1,296 @@
+#include "RepoWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace
+{
+    // Git updates HEAD, index and refs by writing a .lock file and renaming it into place
+    const uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+    // Editors also chmod and touch files in place
+    const uint32_t kWorkTreeMask = kWatchMask | IN_ATTRIB;
+
+    // Report once events stop for this long, but never hold one back longer than the cap
+    const long long kQuietNs = 100 * 1000000LL;
+    const long long kMaxDelayNs = 500 * 1000000LL;
+
+    long long nowNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<long long>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    bool isLockFile(const std::string &name)
+    {
+        return name.size() >= 5 && name.compare(name.size() - 5, 5, ".lock") == 0;
+    }
+}
+
+RepoWatcher::RepoWatcher()
+    : inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      debounceFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      gitDirWatch(-1), commonDirWatch(-1), maxWorkTreeDirs(0), firstPendingNs(0)
+{
+}
+
+RepoWatcher::~RepoWatcher()
+{
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+    if (debounceFd >= 0)
+        close(debounceFd);
+}
+
+bool RepoWatcher::watch(const std::string &gitDir, const std::string &commonDir)
+{
+    if (inotifyFd < 0)
+        return false;
+
+    // Watch the directory rather than the files, renames would orphan a file watch
+    gitDirWatch = inotify_add_watch(inotifyFd, gitDir.c_str(), kWatchMask);
+    headsDir = commonDir + "/refs/heads";
+    watchRefsRecursive(commonDir + "/refs");
+    if (commonDir != gitDir)
+    {
+        // packed-refs lives in the common dir of a linked worktree
+        commonDirWatch = inotify_add_watch(inotifyFd, commonDir.c_str(), kWatchMask);
+    }
+    return gitDirWatch >= 0;
+}
+
+void RepoWatcher::watchRefsRecursive(const std::string &dir)
+{
+    int wd = inotify_add_watch(inotifyFd, dir.c_str(), kWatchMask);
+    if (wd < 0)
+        return;
+    refDirs[wd] = dir;
+
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    while (dirent *entry = readdir(d))
+    {
+        if (entry->d_type == DT_DIR && strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        {
+            watchRefsRecursive(dir + "/" + entry->d_name);
+        }
+    }
+    closedir(d);
+}
+
+bool RepoWatcher::watchWorkTree(const std::string &root, const std::set<std::string> &ignoredDirs,
+                                IgnoreCheck isIgnored, size_t maxDirs)
+{
+    if (inotifyFd < 0)
+        return false;
+
+    maxWorkTreeDirs = maxDirs;
+    ignoredWorkTreeDirs = ignoredDirs;
+    ignoreCheck = std::move(isIgnored);
+    if (watchWorkTreeRecursive(root))
+        return true;
+    unwatchWorkTree();
+    return false;
+}
+
+void RepoWatcher::unwatchWorkTree()
+{
+    // Too large to watch completely: a partial watch would silently miss edits, so drop it
+    for (const auto &entry : workTreeDirs)
+    {
+        inotify_rm_watch(inotifyFd, entry.first);
+    }
+    workTreeDirs.clear();
+    ignoredWorkTreeDirs.clear();
+    maxWorkTreeDirs = 0;
+}
+
+bool RepoWatcher::watchWorkTreeRecursive(const std::string &dir)
+{
+    if (workTreeDirs.size() >= maxWorkTreeDirs)
+        return false;
+    int wd = inotify_add_watch(inotifyFd, dir.c_str(), kWorkTreeMask | IN_ONLYDIR | IN_DONT_FOLLOW);
+    if (wd < 0)
+        return errno != ENOSPC;
+    workTreeDirs[wd] = dir;
+
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return true;
+    bool complete = true;
+    while (dirent *entry = readdir(d))
+    {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, ".git") == 0)
+            continue;
+
+        std::string path = dir + "/" + name;
+        bool directory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            directory = lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (directory && !ignoredWorkTreeDirs.count(path) && !watchWorkTreeRecursive(path))
+        {
+            complete = false;
+            break;
+        }
+    }
+    closedir(d);
+    return complete;
+}
+
+void RepoWatcher::readEvents()
+{
+    if (inotifyFd < 0)
+        return;
+
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t n = read(inotifyFd, buffer, sizeof(buffer));
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + n;)
+        {
+            auto *event = reinterpret_cast<inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+            std::string name = event->len ? event->name : "";
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost, assume everything changed
+                pending.head = pending.index = pending.refs = pending.worktree = true;
+                pending.rescan = true;
+                changed = true;
+                continue;
+            }
+
+            if (event->wd == gitDirWatch || event->wd == commonDirWatch)
+            {
+                if (name == "packed-refs")
+                {
+                    pending.refs = true;
+                    pending.rescan = true;
+                    changed = true;
+                }
+                else if (event->wd == gitDirWatch && (name == "HEAD" || name == "index"))
+                {
+                    (name == "HEAD" ? pending.head : pending.index) = true;
+                    changed = true;
+                }
+                continue;
+            }
+
+            auto ref = refDirs.find(event->wd);
+            if (ref != refDirs.end())
+            {
+                // Ignore lock files, the rename that follows is the real update
+                if (isLockFile(name))
+                    continue;
+                pending.refs = true;
+                changed = true;
+                recordRefChange(ref->second, name, event->mask & IN_ISDIR);
+                if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR))
+                {
+                    watchRefsRecursive(ref->second + "/" + name);
+                }
+                continue;
+            }
+
+            auto tree = workTreeDirs.find(event->wd);
+            if (tree == workTreeDirs.end())
+                continue;
+            if (event->mask & IN_IGNORED)
+            {
+                // The directory was removed, the kernel already dropped the watch
+                workTreeDirs.erase(tree);
+                continue;
+            }
+            if (name.empty() || name == ".git")
+                continue;
+            pending.worktree = true;
+            changed = true;
+            if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR) && maxWorkTreeDirs > 0)
+            {
+                // A build or a package install creating build/ or node_modules/ must not be watched into
+                std::string path = tree->second + "/" + name;
+                if (ignoredWorkTreeDirs.count(path) || (ignoreCheck && ignoreCheck(path)))
+                {
+                    ignoredWorkTreeDirs.insert(path);
+                }
+                else if (!watchWorkTreeRecursive(path))
+                {
+                    unwatchWorkTree();
+                    pending.rescan = true;
+                }
+            }
+        }
+    }
+
+    if (changed)
+    {
+        armTimer();
+    }
+}
+
+void RepoWatcher::recordRefChange(const std::string &dir, const std::string &name, bool isDir)
+{
+    if (dir.compare(0, headsDir.size(), headsDir) != 0 ||
+        (dir.size() > headsDir.size() && dir[headsDir.size()] != '/'))
+        return; // Tags, remotes and other namespaces do not affect local branches
+
+    if (isDir)
+    {
+        // A whole directory of refs appeared or vanished
+        pending.rescan = true;
+        return;
+    }
+    std::string prefix = dir.size() > headsDir.size() ? dir.substr(headsDir.size() + 1) + "/" : "";
+    pending.branches.push_back(prefix + name);
+}
+
+void RepoWatcher::armTimer()
+{
+    long long now = nowNs();
+    if (firstPendingNs == 0)
+    {
+        firstPendingNs = now;
+    }
+
+    // Each event pushes the deadline back, up to the cap measured from the first one
+    long long deadline = std::min(now + kQuietNs, firstPendingNs + kMaxDelayNs);
+    itimerspec spec = {};
+    spec.it_value.tv_sec = deadline / 1000000000;
+    spec.it_value.tv_nsec = deadline % 1000000000;
+    timerfd_settime(debounceFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+bool RepoWatcher::takeChanges(RepoChanges &changes)
+{
+    uint64_t expirations;
+    ssize_t ignored = read(debounceFd, &expirations, sizeof(expirations));
+    (void)ignored;
+
+    firstPendingNs = 0;
+    if (!pending.any())
+        return false;
+    changes = std::move(pending);
+    pending = RepoChanges();
+    return true;
+}
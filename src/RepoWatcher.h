@@ -0,0 +1,82 @@
+#ifndef REPO_WATCHER_H
+#define REPO_WATCHER_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Changes coalesced by RepoWatcher between two takeChanges() calls
+struct RepoChanges
+{
+    bool head = false;     // HEAD moved (checkout, detach)
+    bool index = false;    // .git/index rewritten
+    bool refs = false;     // Any ref, including remotes and tags
+    bool worktree = false; // A file in the working tree was written, created or removed
+
+    std::vector<std::string> branches; // Short names of loose refs/heads entries touched
+    bool rescan = false;               // Names alone cannot tell what changed (packed-refs, directories, overflow)
+
+    bool any() const { return head || index || refs || worktree; }
+};
+
+// Watches .git/HEAD, .git/index, the refs tree and the working tree with
+// inotify so cached repository state is only refreshed when something it
+// depends on actually changed. Bursts of events (a checkout, an IDE saving
+// a dozen files) are coalesced: the watcher reports once the repository has
+// been quiet for a short while, or after a bounded delay at the latest.
+class RepoWatcher
+{
+public:
+    RepoWatcher();
+    ~RepoWatcher();
+
+    RepoWatcher(const RepoWatcher &) = delete;
+    RepoWatcher &operator=(const RepoWatcher &) = delete;
+
+    // Start watching; gitDir holds HEAD and index, commonDir holds refs (they differ in worktrees)
+    bool watch(const std::string &gitDir, const std::string &commonDir);
+
+    // Tells whether a directory created after watchWorkTree is ignored by git
+    using IgnoreCheck = std::function<bool(const std::string &dir)>;
+
+    // Also watch every directory of the working tree except .git and the ignored ones.
+    // Gives up (and watches nothing there) past maxDirs directories, also when new
+    // directories later push the count over.
+    bool watchWorkTree(const std::string &root, const std::set<std::string> &ignoredDirs, IgnoreCheck isIgnored,
+                       size_t maxDirs = 4096);
+
+    // Readable when inotify has events: call readEvents()
+    int fd() const { return inotifyFd; }
+    // Readable when coalesced changes have settled: call takeChanges()
+    int timerFd() const { return debounceFd; }
+
+    // Drain inotify without blocking and (re)arm the settle timer
+    void readEvents();
+
+    // Changes since the last call; false when the timer fired with nothing pending
+    bool takeChanges(RepoChanges &changes);
+
+private:
+    int inotifyFd;
+    int debounceFd;
+    int gitDirWatch;
+    int commonDirWatch;
+    std::map<int, std::string> refDirs;      // Watch descriptor -> directory under refs/
+    std::map<int, std::string> workTreeDirs; // Watch descriptor -> working tree directory
+    std::set<std::string> ignoredWorkTreeDirs;
+    IgnoreCheck ignoreCheck;
+    std::string headsDir;
+    size_t maxWorkTreeDirs;
+    RepoChanges pending;
+    long long firstPendingNs; // When the oldest unreported event arrived, 0 if none
+
+    void watchRefsRecursive(const std::string &dir);
+    bool watchWorkTreeRecursive(const std::string &dir);
+    void unwatchWorkTree();
+    void recordRefChange(const std::string &dir, const std::string &name, bool isDir);
+    void armTimer();
+};
+
+#endif // REPO_WATCHER_H
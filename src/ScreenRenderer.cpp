@@ -0,0 +1,188 @@
+#include "ScreenRenderer.h"
+#include "Instrumentation.h"
+#include <algorithm>
+
+ScreenRenderer::ScreenRenderer()
+{
+}
+
+ScreenRenderer::~ScreenRenderer()
+{
+    for (auto &overlay : overlays)
+    {
+        del_panel(overlay.second);
+    }
+    for (PANEL *panel : basePanels)
+    {
+        del_panel(panel);
+    }
+}
+
+void ScreenRenderer::setBaseWindows(const std::vector<WINDOW *> &windows)
+{
+    for (PANEL *panel : basePanels)
+    {
+        del_panel(panel);
+    }
+    basePanels.clear();
+    dirty.clear();
+    cursorWin = nullptr;
+
+    for (WINDOW *win : windows)
+    {
+        basePanels.push_back(new_panel(win));
+    }
+    // Keep existing popups above the new base layer
+    for (auto &overlay : overlays)
+    {
+        top_panel(overlay.second);
+    }
+    touchAll();
+}
+
+void ScreenRenderer::markDirty(WINDOW *win)
+{
+    if (win && std::find(dirty.begin(), dirty.end(), win) == dirty.end())
+    {
+        // The first damage since the last flush opens a frame
+        if (dirty.empty())
+            Instrumentation::instance().frameDamaged();
+        dirty.push_back(win);
+    }
+}
+
+void ScreenRenderer::touchAll()
+{
+    for (PANEL *panel : basePanels)
+    {
+        touchwin(panel_window(panel));
+        markDirty(panel_window(panel));
+    }
+    for (auto &overlay : overlays)
+    {
+        touchwin(overlay.first);
+        markDirty(overlay.first);
+    }
+}
+
+void ScreenRenderer::showOverlay(WINDOW *win)
+{
+    auto it = std::find_if(overlays.begin(), overlays.end(), [win](const auto &overlay)
+                           { return overlay.first == win; });
+    if (it == overlays.end())
+    {
+        overlays.emplace_back(win, new_panel(win));
+    }
+    markDirty(win);
+}
+
+void ScreenRenderer::hideOverlay(WINDOW *win)
+{
+    auto it = std::find_if(overlays.begin(), overlays.end(), [win](const auto &overlay)
+                           { return overlay.first == win; });
+    if (it == overlays.end())
+        return;
+
+    // The panel library re-exposes whatever the popup covered on the next update_panels
+    del_panel(it->second);
+    overlays.erase(it);
+    dirty.erase(std::remove(dirty.begin(), dirty.end(), win), dirty.end());
+    if (!basePanels.empty())
+    {
+        markDirty(panel_window(basePanels.front()));
+    }
+}
+
+bool ScreenRenderer::flush()
+{
+    if (dirty.empty())
+        return false;
+
+    Instrumentation &instrumentation = Instrumentation::instance();
+    instrumentation.frameFlushing();
+    dirty.clear();
+    update_panels();
+    if (cursorWin)
+    {
+        // Already copied by update_panels, so this only moves the cursor after the topmost panel's
+        wnoutrefresh(cursorWin);
+    }
+    doupdate();
+    instrumentation.frameDone();
+    return true;
+}
+
+void ScreenRenderer::drawLine(WINDOW *win, int y, int x, std::string_view text, int width)
+{
+    wmove(win, y, x);
+    int column = 0;
+    for (char c : text)
+    {
+        if (column >= width)
+            break;
+        if (c == '\t')
+        {
+            int spaces = std::min(8 - (column % 8), width - column);
+            for (int i = 0; i < spaces; i++)
+                waddch(win, ' ');
+            column += spaces;
+        }
+        else if (c == '\r')
+        {
+            continue;
+        }
+        else
+        {
+            unsigned char uc = static_cast<unsigned char>(c);
+            waddch(win, (uc < 32 || uc == 127) ? '?' : uc);
+            column++;
+        }
+    }
+}
+
+void ScreenRenderer::drawMenuBar(WINDOW *win, const std::vector<std::string> &names, size_t selected,
+                                 int attributes, int selectedAttributes)
+{
+    werase(win);
+    box(win, 0, 0);
+    int x = 2;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        int shown = i == selected ? selectedAttributes : attributes;
+        wattron(win, shown);
+        mvwprintw(win, 1, x, "%s", names[i].c_str());
+        wattroff(win, shown);
+        x += names[i].length() + 2;
+    }
+}
+
+void ScreenRenderer::drawRows(WINDOW *win, size_t lineCount, int top, const RowText &text,
+                              const RowAttributes &attributes)
+{
+    int maxY, maxX;
+    getmaxyx(win, maxY, maxX);
+    int visibleLines = maxY - 2;
+    int contentWidth = maxX - 3;
+
+    for (int i = 0; i < visibleLines && static_cast<size_t>(i + top) < lineCount; i++)
+    {
+        int shown = attributes ? attributes(i + top) : A_NORMAL;
+        wattron(win, shown);
+        drawLine(win, i + 1, 1, text(i + top), contentWidth);
+        wattroff(win, shown);
+    }
+
+    if (lineCount <= static_cast<size_t>(std::max(visibleLines, 0)))
+        return;
+    for (int i = 1; i < maxY - 1; i++)
+    {
+        mvwaddch(win, i, maxX - 2, ACS_VLINE);
+    }
+    // Thumb length and position in proportion to the part shown
+    int thumb = std::max(1, static_cast<int>(static_cast<float>(visibleLines) * visibleLines / lineCount));
+    int thumbPos = static_cast<int>((top * static_cast<size_t>(visibleLines - thumb)) / (lineCount - visibleLines));
+    for (int i = 0; i < thumb; i++)
+    {
+        mvwaddch(win, 1 + thumbPos + i, maxX - 2, ACS_BLOCK);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SCREEN_RENDERER_H
+#define SCREEN_RENDERER_H
+
+#include <ncurses.h>
+#include <functional>
+#include <panel.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Collects the windows damaged while handling an event and pushes them to the
+// terminal in one batch: update_panels copies changed lines in stacking order,
+// then a single doupdate. Windows are never cleared, so ncurses only sends
+// changed cells, and popups are long-lived panels rather than per-frame windows.
+class ScreenRenderer
+{
+public:
+    ScreenRenderer();
+    ~ScreenRenderer();
+
+    ScreenRenderer(const ScreenRenderer &) = delete;
+    ScreenRenderer &operator=(const ScreenRenderer &) = delete;
+
+    // Bottom layer windows, stacked in this order; pass {} before deleting them
+    void setBaseWindows(const std::vector<WINDOW *> &windows);
+
+    void markDirty(WINDOW *win);
+
+    // The terminal was overwritten behind ncurses' back (dialogs, resize): re-send from window contents
+    void touchAll();
+
+    // Popups stacked above the base layer; hide before deleting the window
+    void showOverlay(WINDOW *win);
+    void hideOverlay(WINDOW *win);
+
+    // Leave the terminal cursor at win's cursor after every frame, for a line being edited; nullptr to stop
+    void setCursorWindow(WINDOW *win) { cursorWin = win; }
+
+    // Push all damage to the terminal; returns false when nothing was dirty
+    bool flush();
+
+    // Draw text at (y, x) expanding tabs and clipping to width cells, without wrapping
+    static void drawLine(WINDOW *win, int y, int x, std::string_view text, int width);
+
+    // Boxed bar of menu names, the selected one drawn with selectedAttributes
+    static void drawMenuBar(WINDOW *win, const std::vector<std::string> &names, size_t selected,
+                            int attributes, int selectedAttributes);
+
+    using RowText = std::function<std::string_view(size_t)>;
+    using RowAttributes = std::function<int(size_t)>;
+
+    // Rows from top on inside win's border, with a scrollbar in the column left of the right border
+    // when they do not all fit; the border itself and any title are the caller's
+    static void drawRows(WINDOW *win, size_t lineCount, int top, const RowText &text,
+                         const RowAttributes &attributes = nullptr);
+
+private:
+    std::vector<PANEL *> basePanels;
+    std::vector<std::pair<WINDOW *, PANEL *>> overlays; // Bottom to top
+    std::vector<WINDOW *> dirty;
+    WINDOW *cursorWin = nullptr;
+};
+
+#endif // SCREEN_RENDERER_H
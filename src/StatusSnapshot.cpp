@@ -0,0 +1,160 @@
+#include "StatusSnapshot.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // Offset just past the nth space in record, or npos
+    size_t skipFields(std::string_view record, int fields)
+    {
+        size_t pos = 0;
+        for (int i = 0; i < fields; i++)
+        {
+            pos = record.find(' ', pos);
+            if (pos == std::string_view::npos)
+                return pos;
+            pos++;
+        }
+        return pos;
+    }
+}
+
+StatusSnapshot::StatusSnapshot()
+    : upstreamKnown(false), aheadCount(0), behindCount(0)
+{
+}
+
+void StatusSnapshot::parse(std::string &&output)
+{
+    arena = std::move(output);
+    entries.clear();
+    head.clear();
+    upstreamKnown = false;
+    aheadCount = behindCount = 0;
+    if (arena.size() > UINT32_MAX)
+        return;
+
+    size_t pos = 0;
+    while (pos < arena.size())
+    {
+        size_t end = arena.find('\0', pos);
+        if (end == std::string::npos)
+            end = arena.size();
+        std::string_view record(arena.data() + pos, end - pos);
+        size_t start = pos;
+        pos = end + 1;
+        if (record.size() < 2)
+            continue;
+
+        // Field counts before the path: "1 XY sub mH mI mW hH hI path", "2 ... Xscore path", "u XY sub m1 m2 m3 mW h1 h2 h3 path"
+        int fields;
+        switch (record[0])
+        {
+        case '#':
+            parseHeader(record);
+            continue;
+        case '1':
+            fields = 8;
+            break;
+        case '2':
+            fields = 9;
+            break;
+        case 'u':
+            fields = 10;
+            break;
+        case '?':
+            fields = 1;
+            break;
+        default:
+            continue; // Ignored files ('!') are not shown
+        }
+
+        size_t pathStart = skipFields(record, fields);
+        if (pathStart == std::string_view::npos || pathStart >= record.size())
+            continue;
+
+        StatusEntry e = {};
+        e.kind = record[0];
+        e.x = e.kind == '?' ? '?' : record[2];
+        e.y = e.kind == '?' ? '?' : record[3];
+        e.path = static_cast<uint32_t>(start + pathStart);
+        e.pathLength = static_cast<uint32_t>(record.size() - pathStart);
+        if (e.kind == '2')
+        {
+            // The rename source follows as its own NUL-terminated record
+            size_t origEnd = arena.find('\0', pos);
+            if (origEnd == std::string::npos)
+                origEnd = arena.size();
+            e.origPath = static_cast<uint32_t>(pos);
+            e.origPathLength = static_cast<uint32_t>(origEnd - pos);
+            pos = origEnd + 1;
+        }
+        entries.push_back(e);
+    }
+}
+
+void StatusSnapshot::parseHeader(std::string_view header)
+{
+    const std::string_view headPrefix = "# branch.head ";
+    const std::string_view abPrefix = "# branch.ab ";
+    if (header.compare(0, headPrefix.size(), headPrefix) == 0)
+    {
+        head = std::string(header.substr(headPrefix.size()));
+    }
+    else if (header.compare(0, abPrefix.size(), abPrefix) == 0)
+    {
+        // "+<ahead> -<behind>"
+        std::string counts(header.substr(abPrefix.size()));
+        char *end = nullptr;
+        aheadCount = std::abs(static_cast<int>(strtol(counts.c_str(), &end, 10)));
+        behindCount = std::abs(static_cast<int>(strtol(end, nullptr, 10)));
+        upstreamKnown = true;
+    }
+}
+
+bool StatusSnapshot::markStaged(size_t i)
+{
+    StatusEntry &e = entries[i];
+    if (e.kind == '?')
+    {
+        // New file: now added to the index, nothing left in the worktree column
+        e.kind = '1';
+        e.x = 'A';
+        e.y = '.';
+        return true;
+    }
+    if (e.kind != '1' && e.kind != '2')
+        return false; // Resolving a conflict can end several ways
+    if (e.y == '.')
+        return true;
+    if (e.y == 'D' && (e.x == 'A' || e.kind == '2'))
+        return false; // The path leaves the index altogether
+
+    if (e.x == '.' || e.y == 'D')
+        e.x = e.y; // M, D or T moves to the index column
+    e.y = '.';
+    return true;
+}
+
+bool StatusSnapshot::markUnstaged(size_t i)
+{
+    StatusEntry &e = entries[i];
+    if (e.kind == '?' || (e.kind == '1' && e.x == '.'))
+        return true; // Nothing staged
+    if (e.kind != '1' || e.x == 'D')
+        return false; // Renames split in two, a staged deletion may hide an untracked file: re-read
+    if (e.x == 'A')
+    {
+        if (e.y == 'D')
+            return false; // Neither in the index nor on disk afterwards
+        e.kind = '?';
+        e.x = e.y = '?';
+        return true;
+    }
+
+    // Modified or type-changed in the index: the change now shows against the worktree
+    if (e.y == '.')
+        e.y = e.x;
+    e.x = '.';
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef STATUS_SNAPSHOT_H
+#define STATUS_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One path from `git status --porcelain=v2`. Paths are not copied: they are
+// offsets into the snapshot's arena, which is git's output itself.
+struct StatusEntry
+{
+    uint32_t path;           // Offset of the path in the arena
+    uint32_t pathLength;
+    uint32_t origPath;       // Rename/copy source, origPathLength 0 when none
+    uint32_t origPathLength;
+    char x;                  // Index status as git prints it, '.' when unchanged
+    char y;                  // Worktree status, '.' when unchanged
+    char kind;               // Record type: '1' changed, '2' renamed/copied, 'u' unmerged, '?' untracked
+};
+
+// Parsed output of `git status --porcelain=v2 -z --branch`, plus the small
+// in-place edits that staging or unstaging a single path makes to it.
+class StatusSnapshot
+{
+public:
+    StatusSnapshot();
+
+    // Take ownership of git's output and index it; malformed records are skipped
+    void parse(std::string &&output);
+
+    size_t size() const { return entries.size(); }
+    const StatusEntry &entry(size_t i) const { return entries[i]; }
+    std::string_view path(const StatusEntry &e) const { return std::string_view(arena.data() + e.path, e.pathLength); }
+    std::string_view origPath(const StatusEntry &e) const { return std::string_view(arena.data() + e.origPath, e.origPathLength); }
+
+    // From the "# branch.*" headers
+    const std::string &branch() const { return head; }
+    bool hasUpstream() const { return upstreamKnown; }
+    int ahead() const { return aheadCount; }
+    int behind() const { return behindCount; }
+
+    // Apply what `git add` / `git restore --staged` did to one entry.
+    // Returns false when the outcome cannot be derived locally and status must be re-read.
+    bool markStaged(size_t i);
+    bool markUnstaged(size_t i);
+
+private:
+    std::string arena;
+    std::vector<StatusEntry> entries;
+    std::string head;
+    bool upstreamKnown;
+    int aheadCount;
+    int behindCount;
+
+    void parseHeader(std::string_view header);
+};
+
+#endif // STATUS_SNAPSHOT_H
@@ -0,0 +1,324 @@
+#include "StatusView.h"
+#include "Instrumentation.h"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    const char *describe(char code)
+    {
+        switch (code)
+        {
+        case 'M':
+            return "modified:   ";
+        case 'T':
+            return "typechange: ";
+        case 'A':
+            return "new file:   ";
+        case 'D':
+            return "deleted:    ";
+        case 'R':
+            return "renamed:    ";
+        case 'C':
+            return "copied:     ";
+        default:
+            return "changed:    ";
+        }
+    }
+
+    const char *describeConflict(char x, char y)
+    {
+        if (x == 'D' && y == 'D')
+            return "both deleted:    ";
+        if (x == 'A' && y == 'A')
+            return "both added:      ";
+        if (x == 'U' && y == 'U')
+            return "both modified:   ";
+        if (x == 'A')
+            return "added by us:     ";
+        if (y == 'A')
+            return "added by them:   ";
+        if (x == 'D')
+            return "deleted by us:   ";
+        if (y == 'D')
+            return "deleted by them: ";
+        return "unmerged:        ";
+    }
+
+    bool sameFile(const struct stat &a, const struct stat &b)
+    {
+        return a.st_ino == b.st_ino && a.st_size == b.st_size &&
+               a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+    }
+}
+
+StatusView::StatusView(GitCommandHandler &git, const std::string &gitDir, bool untracked)
+    : git(git), indexPath(gitDir + "/index"), untracked(untracked), process{-1, -1, -1}, running(false),
+      buffer(64 * 1024), renderedFirst(0), ownIndex{}
+{
+    rebuildRows();
+    reload();
+}
+
+StatusView::~StatusView()
+{
+    stop();
+}
+
+void StatusView::reload()
+{
+    stop();
+    output.clear();
+    // No optional locks: a background status must not fight the user's own git for index.lock
+    std::vector<std::string> argv = {"git", "--no-optional-locks", "status", "--porcelain=v2", "-z", "--branch"};
+    if (!untracked)
+    {
+        argv.push_back("-uno");
+    }
+    try
+    {
+        process = ProcessRunner::spawn(argv, true);
+    }
+    catch (const std::exception &e)
+    {
+        message = e.what();
+        return;
+    }
+    fcntl(process.outFd, F_SETFL, fcntl(process.outFd, F_GETFL) | O_NONBLOCK);
+    fcntl(process.errFd, F_SETFL, fcntl(process.errFd, F_GETFL) | O_NONBLOCK);
+    running = true;
+}
+
+void StatusView::stop()
+{
+    if (!running)
+        return;
+    kill(-process.pid, SIGTERM);
+    close(process.outFd);
+    close(process.errFd);
+    ProcessRunner::waitForExit(process.pid);
+    running = false;
+}
+
+bool StatusView::pump()
+{
+    if (!running)
+        return false;
+
+    ssize_t n;
+    while ((n = read(process.errFd, buffer.data(), buffer.size())) > 0)
+    {
+        message.assign(buffer.data(), n);
+    }
+
+    for (int reads = 0; reads < 16; reads++)
+    {
+        n = read(process.outFd, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return false; // Nothing more yet
+        if (n == 0)
+            break;
+        Instrumentation::instance().processOutput(process.pid, n);
+        output.append(buffer.data(), n);
+    }
+    if (n != 0)
+        return false;
+
+    // The snapshot is only swapped in once complete, so the old rows stay on screen while git runs
+    close(process.outFd);
+    close(process.errFd);
+    int exitCode = ProcessRunner::waitForExit(process.pid);
+    running = false;
+    if (exitCode == 0)
+    {
+        message.clear();
+        snapshot.parse(std::move(output));
+        rebuildRows();
+    }
+    output.clear();
+    return true;
+}
+
+void StatusView::rebuildRows()
+{
+    rows.clear();
+    rendered.clear();
+    rows.push_back({-1, 0}); // Branch line
+
+    std::vector<Row> sections[4];
+    for (size_t i = 0; i < snapshot.size(); i++)
+    {
+        const StatusEntry &e = snapshot.entry(i);
+        int index = static_cast<int>(i);
+        if (e.kind == 'u')
+        {
+            sections[0].push_back({index, 'U'});
+        }
+        else if (e.kind == '?')
+        {
+            sections[3].push_back({index, '?'});
+        }
+        else
+        {
+            // A file can be both staged and further modified; it shows in both sections
+            if (e.x != '.')
+                sections[1].push_back({index, 'S'});
+            if (e.y != '.')
+                sections[2].push_back({index, 'W'});
+        }
+    }
+
+    for (const std::vector<Row> &section : sections)
+    {
+        if (section.empty())
+            continue;
+        rows.push_back({-1, 0});                      // Blank line
+        rows.push_back({-1, section.front().section}); // Heading
+        rows.insert(rows.end(), section.begin(), section.end());
+    }
+}
+
+std::string StatusView::renderRow(size_t index) const
+{
+    const Row &row = rows[index];
+    if (index == 0)
+    {
+        if (snapshot.branch().empty())
+            return running ? "Reading status..." : "";
+        std::string text = snapshot.branch() == "(detached)" ? "HEAD detached" : "On branch " + snapshot.branch();
+        if (snapshot.hasUpstream() && (snapshot.ahead() || snapshot.behind()))
+        {
+            text += " [ahead " + std::to_string(snapshot.ahead()) + ", behind " + std::to_string(snapshot.behind()) + "]";
+        }
+        return text;
+    }
+
+    if (row.entry < 0)
+    {
+        size_t count = 0;
+        for (size_t i = index + 1; i < rows.size() && rows[i].entry >= 0; i++)
+            count++;
+        switch (row.section)
+        {
+        case 'U':
+            return "Unmerged paths (" + std::to_string(count) + "):";
+        case 'S':
+            return "Staged changes (" + std::to_string(count) + "):";
+        case 'W':
+            return "Unstaged changes (" + std::to_string(count) + "):";
+        case '?':
+            return "Untracked files (" + std::to_string(count) + "):";
+        default:
+            return "";
+        }
+    }
+
+    const StatusEntry &e = snapshot.entry(row.entry);
+    std::string text = "    ";
+    switch (row.section)
+    {
+    case 'U':
+        text += describeConflict(e.x, e.y);
+        break;
+    case 'S':
+        text += describe(e.x);
+        if (e.origPathLength)
+        {
+            text.append(snapshot.origPath(e));
+            text += " -> ";
+        }
+        break;
+    case 'W':
+        text += describe(e.y);
+        break;
+    default:
+        break;
+    }
+    text.append(snapshot.path(e));
+    return text;
+}
+
+std::string StatusView::title() const
+{
+    std::string text = "status - s: stage, u: unstage, r: refresh";
+    if (running)
+        text += " (refreshing)";
+    if (!message.empty())
+        text += " - " + message.substr(0, message.find('\n'));
+    return text;
+}
+
+void StatusView::prepare(size_t first, size_t count)
+{
+    renderedFirst = first;
+    rendered.clear();
+    for (size_t i = first; i < first + count && i < rows.size(); i++)
+    {
+        rendered.push_back(renderRow(i));
+    }
+}
+
+std::string_view StatusView::line(size_t index) const
+{
+    if (index >= renderedFirst && index - renderedFirst < rendered.size())
+        return rendered[index - renderedFirst];
+    if (index >= rows.size())
+        return std::string_view();
+    scratch = renderRow(index);
+    return scratch;
+}
+
+bool StatusView::handleKey(int ch, size_t &cursor)
+{
+    if (ch == 'r')
+    {
+        reload();
+        return true;
+    }
+    if (ch != 's' && ch != 'u')
+        return false;
+    if (cursor >= rows.size() || rows[cursor].entry < 0 || running)
+        return true;
+
+    size_t entry = rows[cursor].entry;
+    const StatusEntry &e = snapshot.entry(entry);
+    std::vector<std::string> paths = {std::string(snapshot.path(e))};
+    if (e.origPathLength)
+        paths.emplace_back(snapshot.origPath(e)); // Both sides of a rename move together
+
+    message = ch == 's' ? git.stagePaths(paths) : git.unstagePaths(paths);
+    stat(indexPath.c_str(), &ownIndex);
+    if (!message.empty())
+    {
+        reload();
+        return true;
+    }
+
+    bool applied = ch == 's' ? snapshot.markStaged(entry) : snapshot.markUnstaged(entry);
+    if (applied)
+        rebuildRows();
+    else
+        reload();
+    return true;
+}
+
+bool StatusView::indexChangedByOthers() const
+{
+    struct stat st;
+    if (stat(indexPath.c_str(), &st) != 0)
+        return true;
+    return !sameFile(st, ownIndex);
+}
+
+void StatusView::repoChanged(const RepoChanges &changes)
+{
+    // Our own stage/unstage already edited the snapshot; only someone else's index write needs a re-read
+    if (changes.head || changes.refs || changes.worktree || (changes.index && indexChangedByOthers()))
+    {
+        reload();
+    }
+}
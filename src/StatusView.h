@@ -0,0 +1,68 @@
+#ifndef STATUS_VIEW_H
+#define STATUS_VIEW_H
+
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include "GitCommandHandler.h"
+#include "PaneView.h"
+#include "ProcessRunner.h"
+#include "StatusSnapshot.h"
+
+// Working tree status grouped into unmerged, staged, unstaged and untracked
+// sections. git status runs once in the background and is parsed into a
+// StatusSnapshot; staging or unstaging the entry under the cursor runs git
+// for that one path and edits the snapshot in place instead of re-reading.
+class StatusView : public PaneView
+{
+public:
+    StatusView(GitCommandHandler &git, const std::string &gitDir, bool untracked);
+    ~StatusView() override;
+
+    StatusView(const StatusView &) = delete;
+    StatusView &operator=(const StatusView &) = delete;
+
+    std::string title() const override;
+    size_t lineCount() const override { return rows.size(); }
+    std::string_view line(size_t index) const override;
+    void prepare(size_t first, size_t count) override;
+    int fd() const override { return running ? process.outFd : -1; }
+    bool pump() override;
+
+    bool hasCursor() const override { return true; }
+    bool handleKey(int ch, size_t &cursor) override;
+    void repoChanged(const RepoChanges &changes) override;
+
+private:
+    struct Row
+    {
+        int entry;    // Index into the snapshot, -1 for headings and blank lines
+        char section; // 'U' unmerged, 'S' staged, 'W' unstaged, '?' untracked, 0 for other rows
+    };
+
+    GitCommandHandler &git;
+    std::string indexPath;
+    bool untracked;
+    StatusSnapshot snapshot;
+    std::vector<Row> rows;
+    std::string message; // Last error, shown in the title
+
+    SpawnedProcess process;
+    bool running;
+    std::vector<char> buffer;
+    std::string output;
+
+    size_t renderedFirst;
+    std::vector<std::string> rendered; // Text of the rows last passed to prepare()
+    mutable std::string scratch;
+
+    struct stat ownIndex; // Index as left by our own last stage/unstage
+
+    void reload();
+    void stop();
+    void rebuildRows();
+    std::string renderRow(size_t index) const;
+    bool indexChangedByOthers() const;
+};
+
+#endif // STATUS_VIEW_H
@@ -3,15 +3,31 @@
 #include <vector>
 #include <cstdlib>
 #include <memory>
+#include <deque>
 #include <stdexcept>
 #include <array>
 #include <map>
 #include <algorithm>
 #include <sstream>
 #include "GitCommandHandler.h"
+#include "CommandExecutor.h"
+#include "RepoWatcher.h"
+#include "OutputBuffer.h"
+#include "ScreenRenderer.h"
+#include "FuzzyFilter.h"
+#include "EventLoop.h"
+#include "LogView.h"
+#include "StatusView.h"
+#include "DiffView.h"
+#include "BlameView.h"
 #include "Dialog.h"
+#include "FilePicker.h"
+#include "PerformanceHud.h"
+#include "CommandHistory.h"
 #include "json.hpp"
 #include <fstream>
+#include <unistd.h>
+#include <csignal>
 
 class GitNCurses
 {
@@ -22,14 +38,65 @@ private:
     WINDOW *inputWin;
     WINDOW *statusWin; // New status bar window
     int maxY, maxX;
-    std::vector<std::string> commandHistory;
-    int historyIndex;
+    CommandHistory commandHistory;        // Prompt history shared across sessions, GITNCURSES_HISTORY
+    size_t historyIndex;                  // Entry recalled with Up/Down; commandHistory.size() is the new line
+    struct LineEditor                     // State of the git> prompt while it has the keyboard
+    {
+        bool active = false;
+        bool fromMenu = false;            // Return to menu mode afterwards
+        std::string text;
+        size_t cursor = 0;
+        std::string draft;                // The line being typed while history is recalled or searched
+        bool searching = false;           // Ctrl-R reverse search
+        std::string query;
+        size_t match = CommandHistory::npos;
+    };
+    LineEditor lineEditor;
     bool isMenuActive;                    // Track if menu is active
     WINDOW *activeWindow;                 // Track the currently active window
     int scrollPosition;                   // Track current scroll position
-    std::vector<std::string> outputLines; // Store output lines for scrolling
+    std::unique_ptr<OutputBuffer> outputLines; // Output of the latest command
+    struct SavedOutput
+    {
+        std::unique_ptr<OutputBuffer> lines;
+        int scrollPosition;
+    };
+    std::deque<SavedOutput> outputHistory; // Earlier outputs, oldest first, spilled out of memory
+    size_t outputHistoryLimit = 10;       // GITNCURSES_OUTPUT_HISTORY, 0 turns history off
+    size_t shownOutput = 0;               // Index into outputHistory; outputHistory.size() is the live output
+    int liveScrollPosition = 0;           // Scroll position of the live output while history is shown
+    size_t scrollbackLimit = 64u << 20;   // GITNCURSES_SCROLLBACK_MB, bytes kept in memory per output
     GitCommandHandler gitHandler;         // Add GitCommandHandler instance
-    Dialog dialog;                        // Add Dialog instance
+    CommandExecutor executor;             // Runs git in the background
+    RepoWatcher repoWatcher;              // Invalidates cached views when .git or the worktree changes
+    GitInvocation runningInvocation;      // Command currently owned by executor
+    bool runningHasOutput = false;
+    std::string statusMessage;            // Transient message shown in the status bar
+    ScreenRenderer renderer;              // Batches window updates into one doupdate per frame
+    EventLoop eventLoop;                  // Waits on keyboard, child pipes and inotify together
+    PerformanceHud hud;                   // 'P' overlay with frame, process, cache and memory figures
+    std::vector<int> commandFds;          // Executor pipes registered with eventLoop
+    std::unique_ptr<PaneView> paneView;   // Lazily loaded pane content; outputLines is shown when null
+    int paneViewFd = -1;                  // paneView pipe registered with eventLoop
+    bool paneFollow = false;              // 'G' keeps the pane at the end while the view loads
+    int paneCursor = 0;                   // Selected row in views that have a cursor
+    WINDOW *submenuWin = nullptr;        // Popup panels live from open to close
+    WINDOW *dynamicSubmenuWin = nullptr;
+    int drawnMenu = -1;                   // Selections currently painted, to repaint only what changed
+    int drawnSubmenu = -1;
+    int drawnDynamicSubmenu = -1;
+    int submenuOwner = -1;                // Menu / item the open popups belong to
+    int dynamicSubmenuOwner = -1;
+    int dynamicTop = 0;                   // First branch row visible in the scrolling popup
+    int drawnDynamicTop = -1;
+    std::string drawnFilter;
+    FuzzyFilter branchFilter;             // Branch names for the Checkout popup, indexed for type-to-filter
+    bool branchesStale = true;            // Reload branch names on next popup open
+    std::deque<int> pendingKeys;          // Read from the terminal, not yet handled
+    int modalDepth = 0;                   // Dialogs waiting in waitForKey
+    Dialog dialog{renderer, [this] { return waitForKey(); }};
+    FilePicker filePicker{renderer, [this] { return waitForKey(); }}; // Multi-select list for Add
+    BlameCache blameCache;                // Finished blames by (path, blob id, HEAD commit)
     nlohmann::json menuJson;
     nlohmann::json helpJson;
     int gPressedCount = 0; // Track consecutive 'g' presses for 'gg'
@@ -39,7 +106,7 @@ private:
         std::string label;
         std::string command;
         std::string description;
-        std::vector<std::string> dynamicItems; // For dynamic submenus (e.g., branch list)
+        bool listsBranches = false; // Opens the branch picker instead of running command directly
     };
 
     struct Menu
@@ -180,6 +247,11 @@ private:
         return {confirmed, input};
     }
 
+    Dialog::DialogResult showDialog(const std::string &title, const std::string &prompt)
+    {
+        return dialog.show(title, prompt);
+    }
+
     void initWindows()
     {
         // Initialize ncurses
@@ -190,6 +262,14 @@ private:
         keypad(stdscr, TRUE);
         curs_set(0); // Hide cursor
 
+        // Esc closes menus and dialogs; ncurses' default of a second for telling a lone Esc from
+        // the start of an arrow key sequence makes every close feel stuck. Local terminals send a
+        // sequence in one write, and an ESCDELAY from the environment still wins.
+        if (!getenv("ESCDELAY"))
+        {
+            set_escdelay(25);
+        }
+
         // Get screen dimensions
         getmaxyx(stdscr, maxY, maxX);
 
@@ -205,6 +285,7 @@ private:
         init_pair(3, COLOR_CYAN, COLOR_BLACK);
         init_pair(4, COLOR_WHITE, COLOR_BLUE);
         init_pair(5, COLOR_BLACK, COLOR_WHITE); // New color pair for status bar
+        init_pair(6, COLOR_RED, COLOR_BLACK);   // Removed lines in diffs
 
         // Create menu window (top)
         menuWin = newwin(menuHeight, maxX, 0, 0);
@@ -233,8 +314,18 @@ private:
         loadJsonFiles();
         buildMenusFromJson();
 
-        // Initialize local branches
-        updateLocalBranches();
+        // Watch HEAD, index, refs and the working tree so cached views refresh on outside changes
+        std::string gitDir, commonDir, workTree;
+        if (gitHandler.getGitDirs(gitDir, commonDir))
+        {
+            repoWatcher.watch(gitDir, commonDir);
+        }
+        if (gitHandler.getWorkTree(workTree))
+        {
+            repoWatcher.watchWorkTree(workTree, gitHandler.getIgnoredDirectories(workTree),
+                                      [this, workTree](const std::string &dir)
+                                      { return gitHandler.isIgnored(workTree, dir); });
+        }
 
         selectedMenu = 0;
         showSubmenu = false;
@@ -253,126 +344,265 @@ private:
         clear();
         refresh();
 
-        // Draw and refresh all windows
+        // Draw all windows and send them as one frame
+        renderer.setBaseWindows({menuWin, outputWin, inputWin, statusWin});
         drawMenu();
         updateStatusBar(); // Initialize status bar
-        wrefresh(menuWin);
-        wrefresh(outputWin);
-        wrefresh(inputWin);
-        wrefresh(statusWin);
-
-        // Force a final refresh of the entire screen
-        doupdate();
+        renderer.flush();
     }
 
     void drawMenu()
     {
-        // Clear and redraw main menu
-        wclear(menuWin);
-        box(menuWin, 0, 0);
-        int x = 2;
-        for (size_t i = 0; i < mainMenu.size(); i++)
+        // Redraw main menu bar only when its selection moved
+        if (drawnMenu != selectedMenu)
         {
-            if (i == selectedMenu)
-            {
-                wattron(menuWin, COLOR_PAIR(4));
-            }
-            else
+            std::vector<std::string> names;
+            for (const auto &menu : mainMenu)
             {
-                wattron(menuWin, COLOR_PAIR(3));
+                names.push_back(menu.name);
             }
-            mvwprintw(menuWin, 1, x, "%s", mainMenu[i].name.c_str());
-            wattroff(menuWin, COLOR_PAIR(3) | COLOR_PAIR(4));
-            x += mainMenu[i].name.length() + 2;
+            ScreenRenderer::drawMenuBar(menuWin, names, selectedMenu, COLOR_PAIR(3), COLOR_PAIR(4));
+            drawnMenu = selectedMenu;
+            renderer.markDirty(menuWin);
         }
 
-        // --- Clear submenu/dynamic submenu area below menu bar ---
-        int menuAreaHeight = 20; // Adjust as needed for max submenu height
-        for (int y = 3; y < 3 + menuAreaHeight && y < maxY; ++y)
+        // Submenu popup: created once per open, then only the old and new selected rows are repainted
+        if (!showSubmenu)
+        {
+            closeSubmenu();
+        }
+        else if (!submenuWin || submenuOwner != selectedMenu)
         {
-            mvwhline(stdscr, y, 0, ' ', maxX);
+            closeSubmenu();
+            openSubmenu();
+        }
+        else if (drawnSubmenu != selectedSubmenu)
+        {
+            drawSubmenuRow(drawnSubmenu);
+            drawSubmenuRow(selectedSubmenu);
+            drawnSubmenu = selectedSubmenu;
+            renderer.markDirty(submenuWin);
         }
-        wnoutrefresh(stdscr);
 
-        // Variables for submenu position (needed for dynamic submenu)
-        int submenuWidth = 20;
-        int submenuX = 2;
-        for (size_t i = 0; i < selectedMenu; i++)
+        // Dynamic submenu follows the same scheme, nested under the selected submenu item
+        // Only the visible window of the branch list is ever drawn
+        bool wantDynamic = showSubmenu && showDynamicSubmenu &&
+                           mainMenu[selectedMenu].items[selectedSubmenu].listsBranches;
+        if (!wantDynamic)
+        {
+            closeDynamicSubmenu();
+            return;
+        }
+        if (!dynamicSubmenuWin || dynamicSubmenuOwner != selectedSubmenu)
         {
-            submenuX += mainMenu[i].name.length() + 2;
+            closeDynamicSubmenu();
+            openDynamicSubmenu();
         }
-        int submenuY = 3;
 
-        // Redraw main windows to ensure no ghosting
-        box(outputWin, 0, 0);
-        box(inputWin, 0, 0);
-        wrefresh(outputWin);
-        wrefresh(inputWin);
-        wrefresh(statusWin);
-        wrefresh(menuWin);
+        int rows = getmaxy(dynamicSubmenuWin) - 2;
+        if (selectedDynamicSubmenu < dynamicTop)
+        {
+            dynamicTop = selectedDynamicSubmenu;
+        }
+        else if (selectedDynamicSubmenu >= dynamicTop + rows)
+        {
+            dynamicTop = selectedDynamicSubmenu - rows + 1;
+        }
 
-        // Draw submenu if active (after main windows, so it's on top)
-        WINDOW *submenuWin = nullptr;
-        if (showSubmenu)
+        if (dynamicTop != drawnDynamicTop || drawnFilter != branchFilter.query())
         {
-            int submenuHeight = mainMenu[selectedMenu].items.size() + 2;
-            submenuWin = newwin(submenuHeight, submenuWidth, submenuY, submenuX);
-            wbkgd(submenuWin, COLOR_PAIR(3));
-            box(submenuWin, 0, 0);
-            for (size_t i = 0; i < mainMenu[selectedMenu].items.size(); i++)
-            {
-                if (i == selectedSubmenu)
-                {
-                    wattron(submenuWin, COLOR_PAIR(4));
-                }
-                else
-                {
-                    wattron(submenuWin, COLOR_PAIR(3));
-                }
-                mvwprintw(submenuWin, i + 1, 1, "%s", mainMenu[selectedMenu].items[i].label.c_str());
-                wattroff(submenuWin, COLOR_PAIR(3) | COLOR_PAIR(4));
-            }
-            wrefresh(submenuWin);
+            drawDynamicSubmenuContents();
         }
+        else if (drawnDynamicSubmenu != selectedDynamicSubmenu)
+        {
+            drawDynamicSubmenuRow(drawnDynamicSubmenu);
+            drawDynamicSubmenuRow(selectedDynamicSubmenu);
+            drawnDynamicSubmenu = selectedDynamicSubmenu;
+            renderer.markDirty(dynamicSubmenuWin);
+        }
+    }
 
-        // Draw dynamic submenu if active (after main windows and submenu)
-        WINDOW *dynamicSubmenuWin = nullptr;
-        if (showDynamicSubmenu && !mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.empty())
+    int submenuX() const
+    {
+        int x = 2;
+        for (size_t i = 0; i < selectedMenu; i++)
         {
-            int dynamicSubmenuWidth = 30;
-            int dynamicSubmenuHeight = mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.size() + 2;
-            int dynamicSubmenuX = submenuX + submenuWidth;
-            int dynamicSubmenuY = submenuY + selectedSubmenu + 1;
+            x += mainMenu[i].name.length() + 2;
+        }
+        return x;
+    }
 
-            dynamicSubmenuWin = newwin(dynamicSubmenuHeight, dynamicSubmenuWidth,
-                                       dynamicSubmenuY, dynamicSubmenuX);
-            wbkgd(dynamicSubmenuWin, COLOR_PAIR(3));
-            box(dynamicSubmenuWin, 0, 0);
+    void openSubmenu()
+    {
+        const int submenuWidth = 20;
+        int submenuHeight = mainMenu[selectedMenu].items.size() + 2;
+        submenuWin = newwin(submenuHeight, submenuWidth, 3, submenuX());
+        wbkgd(submenuWin, COLOR_PAIR(3));
+        box(submenuWin, 0, 0);
+        submenuOwner = selectedMenu;
+        drawnSubmenu = selectedSubmenu;
+        for (size_t i = 0; i < mainMenu[selectedMenu].items.size(); i++)
+        {
+            drawSubmenuRow(i);
+        }
+        renderer.showOverlay(submenuWin);
+    }
 
-            for (size_t i = 0; i < mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.size(); i++)
-            {
-                if (i == selectedDynamicSubmenu)
-                {
-                    wattron(dynamicSubmenuWin, COLOR_PAIR(4));
-                }
-                else
-                {
-                    wattron(dynamicSubmenuWin, COLOR_PAIR(3));
-                }
-                mvwprintw(dynamicSubmenuWin, i + 1, 1, "%s", mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems[i].c_str());
-                wattroff(dynamicSubmenuWin, COLOR_PAIR(3) | COLOR_PAIR(4));
-            }
-            wrefresh(dynamicSubmenuWin);
+    void closeSubmenu()
+    {
+        closeDynamicSubmenu();
+        if (submenuWin)
+        {
+            renderer.hideOverlay(submenuWin);
+            delwin(submenuWin);
+            submenuWin = nullptr;
+            submenuOwner = -1;
         }
+    }
+
+    void drawSubmenuRow(int i)
+    {
+        const auto &items = mainMenu[submenuOwner].items;
+        if (i < 0 || i >= static_cast<int>(items.size()))
+            return;
+        wattron(submenuWin, i == selectedSubmenu ? COLOR_PAIR(4) : COLOR_PAIR(3));
+        mvwprintw(submenuWin, i + 1, 1, "%s", items[i].label.c_str());
+        wattroff(submenuWin, COLOR_PAIR(3) | COLOR_PAIR(4));
+    }
+
+    void openDynamicSubmenu()
+    {
+        // Sized for the full list but never past the status bar; longer lists scroll
+        int dynamicSubmenuWidth = 30;
+        int dynamicSubmenuX = submenuX() + 20;
+        int dynamicSubmenuY = 3 + selectedSubmenu + 1;
+        int available = std::max(3, maxY - 1 - dynamicSubmenuY);
+        // At least one row inside the border, where "(no matches)" goes for an empty list
+        int rows = std::max<int>(1, branchFilter.itemCount());
+        int dynamicSubmenuHeight = std::min<int>(rows + 2, available);
+
+        dynamicSubmenuWin = newwin(dynamicSubmenuHeight, dynamicSubmenuWidth,
+                                   dynamicSubmenuY, dynamicSubmenuX);
+        wbkgd(dynamicSubmenuWin, COLOR_PAIR(3));
+        dynamicSubmenuOwner = selectedSubmenu;
+        drawnDynamicTop = -1;
+        renderer.showOverlay(dynamicSubmenuWin);
+    }
 
-        // Now delete submenu windows if they were created
+    void closeDynamicSubmenu()
+    {
         if (dynamicSubmenuWin)
+        {
+            renderer.hideOverlay(dynamicSubmenuWin);
             delwin(dynamicSubmenuWin);
-        if (submenuWin)
-            delwin(submenuWin);
+            dynamicSubmenuWin = nullptr;
+            dynamicSubmenuOwner = -1;
+        }
+    }
+
+    void drawDynamicSubmenuContents()
+    {
+        int height = getmaxy(dynamicSubmenuWin);
+        int width = getmaxx(dynamicSubmenuWin);
+        werase(dynamicSubmenuWin);
+        box(dynamicSubmenuWin, 0, 0);
+        for (int row = 0; row < height - 2; row++)
+        {
+            drawDynamicSubmenuRow(dynamicTop + row);
+        }
+        if (branchFilter.matchCount() == 0)
+        {
+            mvwprintw(dynamicSubmenuWin, 1, 1, "(no matches)");
+        }
+
+        // Filter text and match count live in the bottom border
+        std::string counter = " " + std::to_string(branchFilter.matchCount()) + "/" +
+                              std::to_string(branchFilter.itemCount()) + " ";
+        if (!branchFilter.query().empty())
+        {
+            std::string filter = " /" + branchFilter.query() + " ";
+            ScreenRenderer::drawLine(dynamicSubmenuWin, height - 1, 1, filter, width - 2 - counter.size());
+        }
+        mvwprintw(dynamicSubmenuWin, height - 1, width - 1 - counter.size(), "%s", counter.c_str());
+
+        drawnDynamicTop = dynamicTop;
+        drawnFilter = branchFilter.query();
+        drawnDynamicSubmenu = selectedDynamicSubmenu;
+        renderer.markDirty(dynamicSubmenuWin);
+    }
+
+    void drawDynamicSubmenuRow(int i)
+    {
+        int row = i - dynamicTop;
+        int width = getmaxx(dynamicSubmenuWin) - 2;
+        if (i < 0 || i >= static_cast<int>(branchFilter.matchCount()) ||
+            row < 0 || row >= getmaxy(dynamicSubmenuWin) - 2)
+            return;
+        wattron(dynamicSubmenuWin, i == selectedDynamicSubmenu ? COLOR_PAIR(4) : COLOR_PAIR(3));
+        ScreenRenderer::drawLine(dynamicSubmenuWin, row + 1, 1, branchFilter.match(i), width);
+        for (int x = getcurx(dynamicSubmenuWin); x <= width; x++)
+        {
+            waddch(dynamicSubmenuWin, ' ');
+        }
+        wattroff(dynamicSubmenuWin, COLOR_PAIR(3) | COLOR_PAIR(4));
+    }
+
+    // Returns false when there is no branch to pick from
+    bool loadBranchList()
+    {
+        // The filter index is rebuilt only when the handler's branch set changed
+        if (branchesStale)
+        {
+            branchFilter.setItems(gitHandler.cachedLocalBranches());
+            branchesStale = false;
+        }
+        branchFilter.setQuery("");
+        selectedDynamicSubmenu = 0;
+        dynamicTop = 0;
+        return branchFilter.itemCount() > 0;
+    }
+
+    // Keys typed while the branch popup is open; returns false for keys it does not handle
+    bool handleBranchFilterKey(int ch)
+    {
+        std::string query = branchFilter.query();
+        int rows = dynamicSubmenuWin ? getmaxy(dynamicSubmenuWin) - 2 : 1;
+        int count = branchFilter.matchCount();
+        if (ch == KEY_BACKSPACE || ch == 127 || ch == 8)
+        {
+            if (query.empty())
+                return true;
+            query.pop_back();
+        }
+        else if (ch == 27 && !query.empty())
+        {
+            // First ESC clears the filter, the second closes the popup
+            query.clear();
+        }
+        else if (ch == KEY_PPAGE || ch == KEY_NPAGE)
+        {
+            int step = ch == KEY_PPAGE ? -rows : rows;
+            selectedDynamicSubmenu = std::max(0, std::min(count - 1, selectedDynamicSubmenu + step));
+            return true;
+        }
+        else if (ch == KEY_HOME || ch == KEY_END)
+        {
+            selectedDynamicSubmenu = ch == KEY_HOME ? 0 : std::max(0, count - 1);
+            return true;
+        }
+        else if (ch < 128 && isgraph(ch))
+        {
+            query.push_back(static_cast<char>(ch));
+        }
+        else
+        {
+            return false;
+        }
 
-        // Force a final refresh to ensure everything is visible
-        doupdate();
+        branchFilter.setQuery(query);
+        selectedDynamicSubmenu = 0;
+        dynamicTop = 0;
+        return true;
     }
 
     std::string getMenuDescription(const std::string &menu, const std::string &submenu)
@@ -393,20 +623,32 @@ private:
 
     void updateStatusBar()
     {
-        wclear(statusWin);
-        std::string branch = gitHandler.getCurrentBranch();
-        std::string status = gitHandler.getRepositoryStatus();
+        werase(statusWin);
+        // Served from the cache, git only runs after a mutating command or a .git change
+        const RepoState &state = gitHandler.getRepoState();
 
         // Get menu description only for highlighted submenu items
-        std::string description;
-        if (showSubmenu)
+        std::string description = statusMessage;
+        if (description.empty() && executor.isRunning())
+        {
+            description = "Running git... (press x to cancel)";
+        }
+        else if (description.empty() && showDynamicSubmenu)
+        {
+            description = "Type to filter, Enter to checkout, ESC to clear/close";
+        }
+        else if (description.empty() && showSubmenu)
         {
             description = getMenuDescription(mainMenu[selectedMenu].name,
                                              mainMenu[selectedMenu].items[selectedSubmenu].label);
         }
 
         // Format status bar content
-        std::string statusText = branch + " (" + status + ")";
+        std::string statusText = state.branch + " (" + state.status + ")";
+        if (state.ahead > 0 || state.behind > 0)
+        {
+            statusText += " [ahead " + std::to_string(state.ahead) + ", behind " + std::to_string(state.behind) + "]";
+        }
 
         // Calculate positions
         int descX = 2;                                // Left-aligned description
@@ -416,25 +658,7 @@ private:
         mvwprintw(statusWin, 0, descX, "%s", description.c_str());
         mvwprintw(statusWin, 0, statusX, "%s", statusText.c_str());
 
-        wrefresh(statusWin);
-    }
-
-    void updateLocalBranches()
-    {
-        // Update the dynamic submenu for Switch Branch
-        for (auto &menu : mainMenu)
-        {
-            if (menu.name == "Git" || menu.name == "Branch")
-            {
-                for (auto &item : menu.items)
-                {
-                    if (item.label == "Switch Branch" || item.label == "Checkout")
-                    {
-                        item.dynamicItems = gitHandler.getLocalBranches();
-                    }
-                }
-            }
-        }
+        renderer.markDirty(statusWin);
     }
 
     void resizeWindows()
@@ -448,7 +672,15 @@ private:
         int statusHeight = 1;                                              // Height for status bar
         int outputHeight = maxY - menuHeight - inputHeight - statusHeight; // Adjusted for status bar
 
-        // Delete old windows
+        // Delete old windows (popups and panels first, they reference them)
+        closeSubmenu();
+        bool hudVisible = hud.isVisible();
+        if (hudVisible)
+        {
+            toggleHud();
+        }
+        renderer.setBaseWindows({});
+        drawnMenu = -1;
         delwin(menuWin);
         delwin(outputWin);
         delwin(inputWin);
@@ -475,17 +707,20 @@ private:
         // Redraw all windows
         clear();
         refresh();
+        renderer.setBaseWindows({menuWin, outputWin, inputWin, statusWin});
         drawMenu();
-        box(outputWin, 0, 0);
         box(inputWin, 0, 0);
+        renderOutput();
         updateStatusBar();
-        wrefresh(menuWin);
-        wrefresh(outputWin);
-        wrefresh(inputWin);
-        wrefresh(statusWin);
-
-        // Force a final refresh
-        doupdate();
+        if (lineEditor.active)
+        {
+            drawPrompt();
+        }
+        if (hudVisible)
+        {
+            toggleHud();
+        }
+        renderer.flush();
     }
 
     void handleMenuInput(int ch)
@@ -494,6 +729,36 @@ private:
         bool contentChanged = false;
         static int gPressed = 0; // static to persist between calls
 
+        // Following the end of a loading view lasts until the next key
+        paneFollow = false;
+
+        // While the branch popup is open, printable keys edit its filter
+        if (showDynamicSubmenu && isMenuActive && handleBranchFilterKey(ch))
+        {
+            drawMenu();
+            return;
+        }
+
+        // Views with a cursor act on the selected row and move it instead of scrolling
+        if (!isMenuActive && !showSubmenu && !showDynamicSubmenu && paneView && paneView->hasCursor())
+        {
+            size_t cursor = paneCursor;
+            if (paneView->handleKey(ch, cursor))
+            {
+                paneCursor = static_cast<int>(cursor);
+                revealPaneCursor();
+                renderOutput();
+                updateStatusBar();
+                return;
+            }
+            if (movePaneCursor(ch))
+            {
+                gPressed = 0;
+                renderOutput();
+                return;
+            }
+        }
+
         switch (ch)
         {
         case '\t': // Tab key toggles between menu and output (scroll) mode
@@ -514,16 +779,7 @@ private:
         case 'I':
             if (isMenuActive)
             {
-                isMenuActive = false;
-                activeWindow = inputWin;
-                std::string command = getInput();
-                if (!command.empty())
-                {
-                    executeMenuCommand(command);
-                }
-                isMenuActive = true;
-                activeWindow = menuWin;
-                drawMenu();
+                openPrompt(true);
             }
             break;
         case KEY_LEFT:
@@ -560,8 +816,13 @@ private:
             if (!isMenuActive && !showSubmenu && !showDynamicSubmenu)
             {
                 int visibleLines = getmaxy(outputWin) - 2;
-                scrollPosition = std::max(0, static_cast<int>(outputLines.size()) - visibleLines);
+                scrollPosition = std::max(0, static_cast<int>(paneLineCount()) - visibleLines);
                 contentChanged = true;
+                if (paneView)
+                {
+                    paneView->loadAll();
+                    paneFollow = true;
+                }
             }
             gPressed = 0;
             break;
@@ -571,7 +832,7 @@ private:
             if (!isMenuActive && !showSubmenu && !showDynamicSubmenu)
             {
                 int visibleLines = getmaxy(outputWin) - 2;
-                if (scrollPosition < static_cast<int>(outputLines.size()) - visibleLines)
+                if (scrollPosition < static_cast<int>(paneLineCount()) - visibleLines)
                 {
                     scrollPosition++;
                     contentChanged = true;
@@ -591,9 +852,9 @@ private:
             }
             break;
         case KEY_UP:
-            if (showDynamicSubmenu && isMenuActive && !mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.empty())
+            if (showDynamicSubmenu && isMenuActive && branchFilter.matchCount() > 0)
             {
-                int dynSize = mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.size();
+                int dynSize = branchFilter.matchCount();
                 selectedDynamicSubmenu = (selectedDynamicSubmenu - 1 + dynSize) % dynSize;
                 menuChanged = true;
             }
@@ -614,9 +875,9 @@ private:
             }
             break;
         case KEY_DOWN:
-            if (showDynamicSubmenu && isMenuActive && !mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.empty())
+            if (showDynamicSubmenu && isMenuActive && branchFilter.matchCount() > 0)
             {
-                int dynSize = mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.size();
+                int dynSize = branchFilter.matchCount();
                 selectedDynamicSubmenu = (selectedDynamicSubmenu + 1) % dynSize;
                 menuChanged = true;
             }
@@ -630,7 +891,7 @@ private:
             {
                 // Scroll down one line
                 int visibleLines = getmaxy(outputWin) - 2;
-                if (scrollPosition < static_cast<int>(outputLines.size()) - visibleLines)
+                if (scrollPosition < static_cast<int>(paneLineCount()) - visibleLines)
                 {
                     scrollPosition++;
                     contentChanged = true;
@@ -649,26 +910,26 @@ private:
                     showSubmenu = true;
                     selectedSubmenu = 0;
                     menuChanged = true;
-                    // Update dynamic items if needed
-                    updateLocalBranches();
                 }
             }
-            else if (!showDynamicSubmenu && isMenuActive && !mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.empty())
-            {
-                showDynamicSubmenu = true;
-                selectedDynamicSubmenu = 0;
-                menuChanged = true;
-            }
-            else if (showDynamicSubmenu && isMenuActive && !mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems.empty())
+            else if (showDynamicSubmenu && isMenuActive)
             {
+                if (branchFilter.matchCount() == 0)
+                    break;
                 // Execute command for selected dynamic item (e.g., checkout branch)
                 std::string baseCmd = mainMenu[selectedMenu].items[selectedSubmenu].command;
-                std::string dynArg = mainMenu[selectedMenu].items[selectedSubmenu].dynamicItems[selectedDynamicSubmenu];
+                std::string dynArg = branchFilter.match(selectedDynamicSubmenu);
                 executeMenuCommand(baseCmd + " " + dynArg);
                 showDynamicSubmenu = false;
                 showSubmenu = false;
                 menuChanged = true;
             }
+            else if (showSubmenu && isMenuActive && mainMenu[selectedMenu].items[selectedSubmenu].listsBranches &&
+                     loadBranchList())
+            {
+                showDynamicSubmenu = true;
+                menuChanged = true;
+            }
             else if (showSubmenu && isMenuActive)
             {
                 executeMenuCommand(mainMenu[selectedMenu].items[selectedSubmenu].command);
@@ -690,6 +951,26 @@ private:
                 menuChanged = true;
             }
             break;
+        case '<':
+        case '>':
+            gPressed = 0;
+            if (!isMenuActive && !showSubmenu && !showDynamicSubmenu)
+            {
+                showOutputHistory(ch == '<' ? -1 : 1);
+                contentChanged = true;
+            }
+            break;
+        case 'P':
+            gPressed = 0;
+            toggleHud();
+            break;
+        case 'x':
+        case 'X':
+            if (executor.isRunning())
+            {
+                executor.cancel();
+            }
+            break;
         case KEY_PPAGE: // Page Up
             if (!isMenuActive)
             {
@@ -702,7 +983,7 @@ private:
             if (!isMenuActive)
             {
                 int visibleLines = getmaxy(outputWin) - 2;
-                scrollPosition = std::min(static_cast<int>(outputLines.size()) - visibleLines,
+                scrollPosition = std::min(static_cast<int>(paneLineCount()) - visibleLines,
                                           scrollPosition + visibleLines);
                 contentChanged = true;
             }
@@ -716,17 +997,42 @@ private:
         {
             drawMenu();
             updateStatusBar();
-            doupdate();
         }
         else if (contentChanged)
         {
-            // Redisplay the current content with new scroll position
-            std::string currentContent;
-            for (const auto &line : outputLines)
-            {
-                currentContent += line + "\n";
-            }
-            displayOutput(currentContent);
+            // Only the scroll position moved: redraw the visible window from the line store
+            renderOutput();
+        }
+    }
+
+    void toggleHud()
+    {
+        if (hud.isVisible())
+        {
+            renderer.hideOverlay(hud.window());
+            hud.hide();
+            return;
+        }
+        hud.show(outputWin);
+        if (hud.isVisible())
+        {
+            renderer.showOverlay(hud.window());
+            updateHud();
+        }
+    }
+
+    void updateHud()
+    {
+        HudInputs inputs{gitHandler.branchCacheStats(), gitHandler.repoStateCacheStats(), 0, 1 + outputHistory.size()};
+        inputs.outputBytes = outputLines->residentBytes() + outputLines->indexBytes();
+        for (const auto &saved : outputHistory)
+        {
+            inputs.outputBytes += saved.lines->residentBytes() + saved.lines->indexBytes();
+        }
+        if (hud.update(inputs))
+        {
+            renderer.markDirty(hud.window());
+            eventLoop.requestRedraw();
         }
     }
 
@@ -738,6 +1044,7 @@ private:
 
         if (cmd == "exit")
         {
+            executor.cancel();
             endwin();
             exit(0);
         }
@@ -748,13 +1055,13 @@ private:
             return;
         }
 
-        std::string output;
+        std::string gitCommand;
         if (cmd == "commit")
         {
-            auto result = dialog.show("Commit Message", "Please provide a commit message:");
+            auto result = showDialog("Commit Message", "Please provide a commit message:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("commit -m \"" + result.input + "\"");
+                gitCommand = "commit -m \"" + result.input + "\"";
             }
             else
             {
@@ -765,24 +1072,18 @@ private:
         }
         else if (cmd == "add")
         {
-            auto result = dialog.show("Add Files", "Enter file(s) to add (use * for all):");
-            if (result.confirmed)
-            {
-                output = gitHandler.executeCommand("add " + result.input);
-            }
-            else
-            {
-                drawMenu();
-                updateStatusBar();
-                return;
-            }
+            // Pick from the changed files; the picks are staged with a single git call
+            stageSelectedFiles();
+            drawMenu();
+            updateStatusBar();
+            return;
         }
         else if (cmd == "branch")
         {
-            auto result = dialog.show("Create Branch", "Enter new branch name:");
+            auto result = showDialog("Create Branch", "Enter new branch name:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("branch " + result.input);
+                gitCommand = "branch " + result.input;
             }
             else
             {
@@ -793,10 +1094,10 @@ private:
         }
         else if (cmd == "checkout")
         {
-            auto result = dialog.show("Checkout", "Enter branch name to checkout:");
+            auto result = showDialog("Checkout", "Enter branch name to checkout:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("checkout " + result.input);
+                gitCommand = "checkout " + result.input;
             }
             else
             {
@@ -807,10 +1108,10 @@ private:
         }
         else if (cmd == "merge")
         {
-            auto result = dialog.show("Merge", "Enter branch name to merge:");
+            auto result = showDialog("Merge", "Enter branch name to merge:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("merge " + result.input);
+                gitCommand = "merge " + result.input;
             }
             else
             {
@@ -821,14 +1122,14 @@ private:
         }
         else if (cmd == "tag")
         {
-            auto result = dialog.show("Create Tag", "Enter tag name:");
+            auto result = showDialog("Create Tag", "Enter tag name:");
             if (result.confirmed)
             {
                 std::string tagName = result.input;
-                auto messageResult = dialog.show("Tag Message", "Enter tag message:");
+                auto messageResult = showDialog("Tag Message", "Enter tag message:");
                 if (messageResult.confirmed)
                 {
-                    output = gitHandler.executeCommand("tag -a " + tagName + " -m \"" + messageResult.input + "\"");
+                    gitCommand = "tag -a " + tagName + " -m \"" + messageResult.input + "\"";
                 }
                 else
                 {
@@ -846,10 +1147,10 @@ private:
         }
         else if (cmd == "push")
         {
-            auto result = dialog.show("Push", "Enter remote and branch (e.g., origin main):");
+            auto result = showDialog("Push", "Enter remote and branch (e.g., origin main):");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("push " + result.input);
+                gitCommand = "push " + result.input;
             }
             else
             {
@@ -860,10 +1161,10 @@ private:
         }
         else if (cmd == "pull")
         {
-            auto result = dialog.show("Pull", "Enter remote and branch (e.g., origin main):");
+            auto result = showDialog("Pull", "Enter remote and branch (e.g., origin main):");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("pull " + result.input);
+                gitCommand = "pull " + result.input;
             }
             else
             {
@@ -874,16 +1175,16 @@ private:
         }
         else if (cmd == "stash")
         {
-            auto result = dialog.show("Stash", "Enter stash message (optional):");
+            auto result = showDialog("Stash", "Enter stash message (optional):");
             if (result.confirmed)
             {
                 if (result.input.empty())
                 {
-                    output = gitHandler.executeCommand("stash");
+                    gitCommand = "stash";
                 }
                 else
                 {
-                    output = gitHandler.executeCommand("stash push -m \"" + result.input + "\"");
+                    gitCommand = "stash push -m \"" + result.input + "\"";
                 }
             }
             else
@@ -895,18 +1196,18 @@ private:
         }
         else if (cmd == "stash pop")
         {
-            output = gitHandler.executeCommand("stash pop");
+            gitCommand = "stash pop";
         }
         else if (cmd == "stash list")
         {
-            output = gitHandler.executeCommand("stash list");
+            gitCommand = "stash list";
         }
         else if (cmd == "reset")
         {
-            auto result = dialog.show("Reset", "Enter commit hash or HEAD~n:");
+            auto result = showDialog("Reset", "Enter commit hash or HEAD~n:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("reset " + result.input);
+                gitCommand = "reset " + result.input;
             }
             else
             {
@@ -917,10 +1218,10 @@ private:
         }
         else if (cmd == "revert")
         {
-            auto result = dialog.show("Revert", "Enter commit hash to revert:");
+            auto result = showDialog("Revert", "Enter commit hash to revert:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("revert " + result.input);
+                gitCommand = "revert " + result.input;
             }
             else
             {
@@ -931,10 +1232,10 @@ private:
         }
         else if (cmd == "cherry-pick")
         {
-            auto result = dialog.show("Cherry-pick", "Enter commit hash to cherry-pick:");
+            auto result = showDialog("Cherry-pick", "Enter commit hash to cherry-pick:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("cherry-pick " + result.input);
+                gitCommand = "cherry-pick " + result.input;
             }
             else
             {
@@ -945,10 +1246,10 @@ private:
         }
         else if (cmd == "rebase")
         {
-            auto result = dialog.show("Rebase", "Enter branch to rebase onto:");
+            auto result = showDialog("Rebase", "Enter branch to rebase onto:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("rebase " + result.input);
+                gitCommand = "rebase " + result.input;
             }
             else
             {
@@ -959,13 +1260,13 @@ private:
         }
         else if (cmd == "remote add")
         {
-            auto nameResult = dialog.show("Remote Name", "Enter remote name (e.g., origin):");
+            auto nameResult = showDialog("Remote Name", "Enter remote name (e.g., origin):");
             if (nameResult.confirmed)
             {
-                auto urlResult = dialog.show("Remote URL", "Enter remote URL:");
+                auto urlResult = showDialog("Remote URL", "Enter remote URL:");
                 if (urlResult.confirmed)
                 {
-                    output = gitHandler.executeCommand("remote add " + nameResult.input + " " + urlResult.input);
+                    gitCommand = "remote add " + nameResult.input + " " + urlResult.input;
                 }
                 else
                 {
@@ -983,10 +1284,10 @@ private:
         }
         else if (cmd == "remote remove")
         {
-            auto result = dialog.show("Remove Remote", "Enter remote name to remove:");
+            auto result = showDialog("Remove Remote", "Enter remote name to remove:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("remote remove " + result.input);
+                gitCommand = "remote remove " + result.input;
             }
             else
             {
@@ -997,26 +1298,36 @@ private:
         }
         else if (cmd == "remote -v")
         {
-            output = gitHandler.executeCommand("remote -v");
+            gitCommand = "remote -v";
         }
         else if (cmd == "log")
         {
-            output = gitHandler.executeCommand("log --oneline --graph --all");
+            // Paged view: git log is read only as far as the user scrolls
+            openLogView();
+            updateStatusBar();
+            return;
         }
         else if (cmd == "status")
         {
-            output = gitHandler.executeCommand("status");
+            // Parsed view: entries can be staged and unstaged in place
+            openStatusView();
+            drawMenu();
+            updateStatusBar();
+            return;
         }
         else if (cmd == "diff")
         {
-            output = gitHandler.executeCommand("diff");
+            // Streamed view: indexed as it arrives, huge files collapsed
+            openDiffView({"diff"});
+            updateStatusBar();
+            return;
         }
         else if (cmd == "show")
         {
-            auto result = dialog.show("Show Commit", "Enter commit hash:");
+            auto result = showDialog("Show Commit", "Enter commit hash:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("show " + result.input);
+                gitCommand = "show " + result.input;
             }
             else
             {
@@ -1027,10 +1338,14 @@ private:
         }
         else if (cmd == "blame")
         {
-            auto result = dialog.show("Blame", "Enter file path:");
+            auto result = showDialog("Blame", "Enter file path:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("blame " + result.input);
+                // Incremental view, reused from the cache until the file changes or a commit is made
+                openBlameView(result.input);
+                drawMenu();
+                updateStatusBar();
+                return;
             }
             else
             {
@@ -1041,10 +1356,10 @@ private:
         }
         else if (cmd == "clean")
         {
-            auto result = dialog.show("Clean", "Enter -f to force, -d for directories, -x for ignored files:");
+            auto result = showDialog("Clean", "Enter -f to force, -d for directories, -x for ignored files:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("clean " + result.input);
+                gitCommand = "clean " + result.input;
             }
             else
             {
@@ -1055,16 +1370,16 @@ private:
         }
         else if (cmd == "fetch")
         {
-            auto result = dialog.show("Fetch", "Enter remote name (optional):");
+            auto result = showDialog("Fetch", "Enter remote name (optional):");
             if (result.confirmed)
             {
                 if (result.input.empty())
                 {
-                    output = gitHandler.executeCommand("fetch --all");
+                    gitCommand = "fetch --all";
                 }
                 else
                 {
-                    output = gitHandler.executeCommand("fetch " + result.input);
+                    gitCommand = "fetch " + result.input;
                 }
             }
             else
@@ -1076,14 +1391,14 @@ private:
         }
         else if (cmd == "init")
         {
-            output = gitHandler.executeCommand("init");
+            gitCommand = "init";
         }
         else if (cmd == "clone")
         {
-            auto result = dialog.show("Clone", "Enter repository URL:");
+            auto result = showDialog("Clone", "Enter repository URL:");
             if (result.confirmed)
             {
-                output = gitHandler.executeCommand("clone " + result.input);
+                gitCommand = "clone " + result.input;
             }
             else
             {
@@ -1094,98 +1409,751 @@ private:
         }
         else
         {
-            output = gitHandler.executeCommand(command);
+            gitCommand = command;
         }
 
-        displayOutput(output);
+        startCommand(gitCommand);
         updateStatusBar();
 
         drawMenu();
     }
 
-    void displayOutput(const std::string &output)
+    void startCommand(const std::string &command)
     {
-        wclear(outputWin);
-        box(outputWin, 0, 0);
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
 
-        // Get window dimensions
-        int maxY, maxX;
-        getmaxyx(outputWin, maxY, maxX);
+        GitInvocation invocation = gitHandler.prepareCommand(command);
+        if (invocation.args.empty())
+        {
+            displayOutput(invocation.output);
+            return;
+        }
 
-        // Create a subwindow for the content area, leaving space for scrollbar
-        WINDOW *contentWin = derwin(outputWin, maxY - 2, maxX - 3, 1, 1);
-        scrollok(contentWin, TRUE);
+        // Show the command line right away, output streams in below it
+        runningInvocation = invocation;
+        runningHasOutput = false;
+        scrollPosition = 0;
+        displayOutput("$ " + invocation.display + "\n\n");
 
-        // Split output into lines and store them
-        outputLines.clear();
-        std::istringstream iss(output);
-        std::string line;
-        while (std::getline(iss, line))
+        std::vector<std::string> argv = invocation.args;
+        argv.insert(argv.begin(), "git");
+        try
+        {
+            executor.start(argv);
+            watchCommandPipes();
+        }
+        catch (const std::exception &e)
         {
-            outputLines.push_back(line);
+            appendOutput(std::string("Error: ") + e.what() + "\n");
+            renderOutput();
         }
+    }
 
-        // Ensure scroll position is valid
-        int visibleLines = maxY - 2;
-        scrollPosition = std::min(scrollPosition, static_cast<int>(outputLines.size()) - visibleLines);
-        scrollPosition = std::max(0, scrollPosition);
+    void watchCommandPipes()
+    {
+        // Stop watching pipes the executor closed at EOF, their fd numbers may be reused
+        std::vector<int> open = executor.openFds();
+        for (int fd : commandFds)
+        {
+            if (std::find(open.begin(), open.end(), fd) == open.end())
+                eventLoop.unwatch(fd);
+        }
+        for (int fd : open)
+        {
+            eventLoop.watch(fd, [this]
+                            { pumpCommand(); });
+        }
+        commandFds = open;
+    }
+
+    void pumpCommand()
+    {
+        if (!executor.isRunning())
+            return;
 
-        // Display visible lines
-        for (int i = 0; i < visibleLines && (i + scrollPosition) < outputLines.size(); i++)
+        bool received = false;
+        bool finished = executor.pump([this, &received](const char *data, size_t size)
+                                      {
+                                          appendOutput(data, size);
+                                          received = true;
+                                      });
+        if (received)
         {
-            mvwprintw(contentWin, i, 0, "%s", outputLines[i + scrollPosition].c_str());
+            runningHasOutput = true;
         }
 
-        // Draw scrollbar if needed
-        if (outputLines.size() > visibleLines)
+        if (finished)
         {
-            // Draw scrollbar track
-            for (int i = 1; i < maxY - 1; i++)
+            // The executor has just reaped the command, so it is the last process instrumentation saw
+            hud.commandFinished(Instrumentation::instance().lastFinishedProcess());
+            if (executor.wasCancelled())
             {
-                mvwaddch(outputWin, i, maxX - 2, ACS_VLINE);
+                appendOutput("\n[Command cancelled]\n");
             }
+            else if (!runningHasOutput && !runningInvocation.emptyMessage.empty())
+            {
+                appendOutput(runningInvocation.emptyMessage + "\n");
+            }
+            if (runningInvocation.refreshBranches && gitHandler.updateLocalBranches())
+            {
+                branchesStale = true;
+            }
+            if (runningInvocation.mutating)
+            {
+                gitHandler.invalidateRepoState();
+            }
+            statusMessage.clear();
+            renderOutput();
+            updateStatusBar();
+        }
+        else if (received)
+        {
+            renderOutput();
+        }
+        watchCommandPipes();
+        eventLoop.requestRedraw();
+    }
+
+    void appendOutput(const char *data, size_t size)
+    {
+        // Keep following the tail unless the user scrolled up
+        int visibleLines = getmaxy(outputWin) - 2;
+        bool live = shownOutput == outputHistory.size();
+        bool atBottom = scrollPosition >= static_cast<int>(outputLines->lineCount()) - visibleLines;
+
+        // Only the new bytes are indexed, earlier lines are left untouched
+        outputLines->append(data, size);
+
+        if (atBottom && live)
+        {
+            scrollPosition = std::max(0, static_cast<int>(outputLines->lineCount()) - visibleLines);
+        }
+    }
+
+    void appendOutput(const std::string &text)
+    {
+        appendOutput(text.data(), text.size());
+    }
+
+    bool movePaneCursor(int ch)
+    {
+        int step;
+        switch (ch)
+        {
+        case 'j':
+        case 'J':
+        case KEY_DOWN:
+            step = 1;
+            break;
+        case 'k':
+        case 'K':
+        case KEY_UP:
+            step = -1;
+            break;
+        default:
+            return false;
+        }
+        int last = static_cast<int>(paneLineCount()) - 1;
+        paneCursor = std::max(0, std::min(paneCursor + step, last));
+        revealPaneCursor();
+        return true;
+    }
+
+    void revealPaneCursor()
+    {
+        // Scroll just enough to keep the cursor row visible
+        int visibleLines = getmaxy(outputWin) - 2;
+        if (paneCursor < scrollPosition)
+        {
+            scrollPosition = paneCursor;
+        }
+        else if (paneCursor >= scrollPosition + visibleLines)
+        {
+            scrollPosition = paneCursor - visibleLines + 1;
+        }
+    }
+
+    void stageSelectedFiles()
+    {
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
+        std::vector<ChangedFile> files;
+        try
+        {
+            files = gitHandler.getUnstagedFiles();
+        }
+        catch (const std::exception &e)
+        {
+            displayOutput(std::string("Error: ") + e.what());
+            return;
+        }
+        if (files.empty())
+        {
+            displayOutput("Nothing to add: no unstaged or untracked changes.");
+            return;
+        }
+
+        std::vector<std::string> items;
+        items.reserve(files.size());
+        for (const auto &file : files)
+        {
+            items.push_back(std::string{file.index, file.workTree, ' '} + file.path);
+        }
+        FilePicker::PickerResult result = filePicker.show("Add Files", items);
+        if (!result.confirmed)
+            return;
+
+        std::vector<std::string> paths;
+        paths.reserve(result.selected.size());
+        for (size_t index : result.selected)
+        {
+            paths.push_back(std::move(files[index].path));
+        }
+        std::string error = gitHandler.stagePaths(paths);
+        gitHandler.invalidateRepoState(StateDirty);
+        if (error.empty())
+        {
+            displayOutput("Staged " + std::to_string(paths.size()) + (paths.size() == 1 ? " file." : " files."));
+        }
+        else
+        {
+            displayOutput(error);
+        }
+    }
+
+    void openStatusView()
+    {
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
+        std::string gitDir, commonDir;
+        gitHandler.getGitDirs(gitDir, commonDir);
+        closePaneView();
+        resetOutput();
+        paneView = std::make_unique<StatusView>(gitHandler, gitDir, gitHandler.getUntrackedScan());
+        scrollPosition = 0;
+        paneCursor = 0;
+        renderOutput();
+    }
+
+    void openDiffView(const std::vector<std::string> &args)
+    {
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
+        closePaneView();
+        resetOutput();
+        paneView = std::make_unique<DiffView>(args);
+        scrollPosition = 0;
+        paneCursor = 0;
+        renderOutput();
+    }
+
+    void openBlameView(const std::string &path)
+    {
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
+        std::string blob = gitHandler.hashFile(path);
+        closePaneView();
+        resetOutput();
+        paneView = std::make_unique<BlameView>(path, blob, gitHandler.getHeadCommit(), blameCache);
+        scrollPosition = 0;
+        renderOutput();
+    }
+
+    void openLogView()
+    {
+        if (executor.isRunning())
+        {
+            statusMessage = "A command is still running (press x to cancel)";
+            return;
+        }
+        std::string gitDir, commonDir;
+        gitHandler.getGitDirs(gitDir, commonDir);
+        closePaneView();
+        resetOutput();
+        paneView = std::make_unique<LogView>(commonDir + "/objects");
+        scrollPosition = 0;
+        renderOutput();
+    }
 
-            // Calculate scrollbar thumb position and length
-            float scrollbarRatio = static_cast<float>(visibleLines) / outputLines.size();
-            int scrollbarLength = std::max(1, static_cast<int>(visibleLines * scrollbarRatio));
-            int scrollbarPos = static_cast<int>((scrollPosition * (visibleLines - scrollbarLength)) /
-                                                (outputLines.size() - visibleLines));
+    void closePaneView()
+    {
+        if (paneViewFd >= 0)
+        {
+            eventLoop.unwatch(paneViewFd);
+            paneViewFd = -1;
+        }
+        paneView.reset();
+        paneFollow = false;
+    }
 
-            // Draw scrollbar thumb
-            for (int i = 0; i < scrollbarLength; i++)
+    void watchPaneView()
+    {
+        // A view only wants its pipe watched while rows it needs are missing
+        int fd = paneView ? paneView->fd() : -1;
+        if (fd == paneViewFd)
+            return;
+        if (paneViewFd >= 0)
+        {
+            eventLoop.unwatch(paneViewFd);
+        }
+        paneViewFd = fd;
+        if (fd >= 0)
+        {
+            eventLoop.watch(fd, [this]
+                            { pumpPaneView(); });
+        }
+    }
+
+    void pumpPaneView()
+    {
+        if (paneView && paneView->pump())
+        {
+            if (paneFollow)
             {
-                mvwaddch(outputWin, 1 + scrollbarPos + i, maxX - 2, ACS_BLOCK);
+                int visibleLines = getmaxy(outputWin) - 2;
+                scrollPosition = std::max(0, static_cast<int>(paneView->lineCount()) - visibleLines);
             }
+            renderOutput();
+            eventLoop.requestRedraw();
         }
+        watchPaneView();
+    }
 
-        // Refresh both windows
-        wrefresh(contentWin);
-        wrefresh(outputWin);
+    const OutputBuffer &visibleOutput() const
+    {
+        return shownOutput < outputHistory.size() ? *outputHistory[shownOutput].lines : *outputLines;
+    }
 
-        // Clean up the subwindow
-        delwin(contentWin);
+    size_t paneLineCount() const
+    {
+        return paneView ? paneView->lineCount() : visibleOutput().lineCount();
     }
 
-    std::string getInput()
+    std::string_view paneLine(size_t index) const
     {
-        wclear(inputWin);
+        return paneView ? paneView->line(index) : visibleOutput().line(index);
+    }
+
+    void displayOutput(const std::string &output)
+    {
+        closePaneView();
+        resetOutput();
+        outputLines->append(output);
+        renderOutput();
+    }
+
+    void resetOutput()
+    {
+        // The previous output moves to history, out of memory, instead of being dropped
+        if (outputHistoryLimit > 0 && outputLines->lineCount() > 0)
+        {
+            outputLines->spillAll();
+            outputHistory.push_back({std::move(outputLines), liveOutputScroll()});
+            if (outputHistory.size() > outputHistoryLimit)
+            {
+                outputHistory.pop_front();
+            }
+            outputLines = std::make_unique<OutputBuffer>(256 * 1024, scrollbackLimit);
+        }
+        else
+        {
+            outputLines->clear();
+        }
+        shownOutput = outputHistory.size();
+    }
+
+    int liveOutputScroll() const
+    {
+        return shownOutput == outputHistory.size() ? scrollPosition : liveScrollPosition;
+    }
+
+    void showOutputHistory(int step)
+    {
+        if (paneView)
+        {
+            // Views are not kept; '<' leaves the view for the outputs before it
+            if (step > 0 || outputHistory.empty())
+                return;
+            closePaneView();
+            liveScrollPosition = 0;
+            shownOutput = outputHistory.size() - 1;
+            scrollPosition = outputHistory[shownOutput].scrollPosition;
+            return;
+        }
+
+        size_t target = shownOutput;
+        if (step < 0 && target > 0)
+            target--;
+        else if (step > 0 && target < outputHistory.size())
+            target++;
+        if (target == shownOutput)
+            return;
+
+        // Each output keeps its own scroll position
+        if (shownOutput == outputHistory.size())
+            liveScrollPosition = scrollPosition;
+        else
+            outputHistory[shownOutput].scrollPosition = scrollPosition;
+        shownOutput = target;
+        scrollPosition = shownOutput == outputHistory.size() ? liveScrollPosition : outputHistory[shownOutput].scrollPosition;
+    }
+
+    static int styleAttributes(PaneView::LineStyle style)
+    {
+        switch (style)
+        {
+        case PaneView::LineStyle::Header:
+            return A_BOLD;
+        case PaneView::LineStyle::Hunk:
+            return COLOR_PAIR(3);
+        case PaneView::LineStyle::Added:
+            return COLOR_PAIR(1);
+        case PaneView::LineStyle::Removed:
+            return COLOR_PAIR(6);
+        case PaneView::LineStyle::Note:
+            return COLOR_PAIR(2);
+        default:
+            return A_NORMAL;
+        }
+    }
+
+    void renderOutput()
+    {
+        werase(outputWin);
+        box(outputWin, 0, 0);
+
+        // Get window dimensions
+        int maxY, maxX;
+        getmaxyx(outputWin, maxY, maxX);
+
+        // Content area sits inside the border, leaving a column for the scrollbar
+        int contentWidth = maxX - 3;
+
+        // Ensure scroll position is valid
+        int visibleLines = maxY - 2;
+        size_t lineCount = paneLineCount();
+        scrollPosition = std::min(scrollPosition, static_cast<int>(lineCount) - visibleLines);
+        scrollPosition = std::max(0, scrollPosition);
+
+        // Lazy views load just the rows about to be drawn
+        if (paneView)
+        {
+            paneView->prepare(scrollPosition, visibleLines);
+            ScreenRenderer::drawLine(outputWin, 0, 2, " " + paneView->title() + " ", maxX - 4);
+            watchPaneView();
+        }
+        else if (shownOutput < outputHistory.size())
+        {
+            std::string title = " earlier output " + std::to_string(shownOutput + 1) + "/" +
+                                std::to_string(outputHistory.size()) + " - <: older, >: newer ";
+            ScreenRenderer::drawLine(outputWin, 0, 2, title, maxX - 4);
+        }
+
+        // Keep the cursor on screen when the view shrank or scrolled underneath it
+        bool cursor = paneView && paneView->hasCursor();
+        if (cursor)
+        {
+            paneCursor = std::min(paneCursor, std::max(0, static_cast<int>(lineCount) - 1));
+            paneCursor = std::max(scrollPosition, std::min(paneCursor, scrollPosition + visibleLines - 1));
+        }
+
+        // Visible lines and, when they do not all fit, the scrollbar
+        auto text = [this](size_t index)
+        { return paneLine(index); };
+        auto attributes = [this](size_t index)
+        { return paneView ? styleAttributes(paneView->lineStyle(index)) : A_NORMAL; };
+        ScreenRenderer::drawRows(outputWin, lineCount, scrollPosition, text, attributes);
+        if (cursor && static_cast<size_t>(paneCursor) < lineCount && !isMenuActive)
+        {
+            mvwchgat(outputWin, paneCursor - scrollPosition + 1, 1, contentWidth, A_REVERSE, 0, nullptr);
+        }
+
+        renderer.markDirty(outputWin);
+    }
+
+    void drawInputLine(const std::string &label, const std::string &text, size_t cursor)
+    {
+        // Scroll the line sideways so the cursor stays visible
+        int width = getmaxx(inputWin) - 2 - static_cast<int>(label.size());
+        size_t first = 0;
+        if (width > 1 && cursor >= static_cast<size_t>(width))
+        {
+            first = cursor - width + 1;
+        }
+        werase(inputWin);
         box(inputWin, 0, 0);
-        mvwprintw(inputWin, 1, 1, "git> ");
-        wrefresh(inputWin);
+        mvwprintw(inputWin, 1, 1, "%s", label.c_str());
+        if (width > 0)
+        {
+            ScreenRenderer::drawLine(inputWin, 1, 1 + label.size(), std::string_view(text).substr(first), width);
+        }
+        wmove(inputWin, 1, 1 + label.size() + (cursor - first));
+        renderer.markDirty(inputWin);
+        renderer.setCursorWindow(inputWin);
+    }
 
-        char input[256];
-        echo();
-        wgetstr(inputWin, input);
-        noecho();
+    // Tab: complete the word before the cursor as a branch name
+    void completeBranch(std::string &text, size_t &cursor)
+    {
+        size_t start = text.rfind(' ', cursor == 0 ? 0 : cursor - 1);
+        start = (start == std::string::npos || start >= cursor) ? 0 : start + 1;
+        std::string word = text.substr(start, cursor - start);
+        if (start == 0 || word.empty() || word[0] == '-')
+            return; // The command itself and options are not branch names
+
+        const size_t shown = 50;
+        std::vector<std::string> matches = gitHandler.branchesWithPrefix(word, shown + 1);
+        if (matches.empty())
+        {
+            statusMessage = "No branch starts with " + word;
+        }
+        else if (matches.size() == 1)
+        {
+            std::string completion = matches[0].substr(word.size()) + " ";
+            text.insert(cursor, completion);
+            cursor += completion.size();
+            statusMessage.clear();
+        }
+        else
+        {
+            // Extend to the longest prefix all matches share, not just the listed ones; list them when that adds nothing
+            std::string common = gitHandler.branchCommonPrefix(word);
+            if (common.size() > word.size())
+            {
+                text.insert(cursor, common.substr(word.size()));
+                cursor += common.size() - word.size();
+                statusMessage.clear();
+            }
+            else
+            {
+                statusMessage.clear();
+                for (size_t i = 0; i < matches.size() && i < shown; i++)
+                {
+                    statusMessage += matches[i] + "  ";
+                }
+                if (matches.size() > shown)
+                    statusMessage += "...";
+            }
+        }
+        updateStatusBar();
+    }
 
-        std::string command(input);
-        if (!command.empty())
+    // The git> prompt is a mode of the main loop rather than a blocking read:
+    // keys reach it through handleKey, so command output keeps streaming and
+    // .git changes keep arriving while a command is typed. Up/Down recall
+    // earlier commands, Ctrl-R searches them incrementally, Tab completes
+    // branch names, Enter runs the line and Esc cancels it.
+    void openPrompt(bool fromMenu)
+    {
+        lineEditor = LineEditor();
+        lineEditor.active = true;
+        lineEditor.fromMenu = fromMenu;
+        historyIndex = commandHistory.size();
+        if (fromMenu)
         {
-            commandHistory.push_back(command);
-            historyIndex = commandHistory.size();
+            isMenuActive = false;
+            activeWindow = inputWin;
         }
+        curs_set(1);
+        drawPrompt();
+    }
 
-        return command;
+    void drawPrompt()
+    {
+        LineEditor &editor = lineEditor;
+        if (editor.searching)
+        {
+            bool failed = editor.match == CommandHistory::npos && !editor.query.empty();
+            std::string label = (failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`") + editor.query + "': ";
+            drawInputLine(label, editor.text, editor.text.size());
+        }
+        else
+        {
+            drawInputLine("git> ", editor.text, editor.cursor);
+        }
+    }
+
+    void closePrompt(bool accepted)
+    {
+        std::string command = lineEditor.text;
+        bool fromMenu = lineEditor.fromMenu;
+        lineEditor = LineEditor();
+
+        curs_set(0);
+        renderer.setCursorWindow(nullptr);
+        if (!statusMessage.empty())
+        {
+            statusMessage.clear();
+            updateStatusBar();
+        }
+        werase(inputWin);
+        box(inputWin, 0, 0);
+        renderer.markDirty(inputWin);
+
+        if (accepted && !command.empty())
+        {
+            commandHistory.add(command);
+            executeMenuCommand(command);
+        }
+        if (fromMenu)
+        {
+            isMenuActive = true;
+            activeWindow = menuWin;
+            drawMenu();
+        }
+    }
+
+    // Reverse search keys; returns false for keys that leave the search and act in the editor
+    bool handleSearchKey(int ch)
+    {
+        LineEditor &editor = lineEditor;
+        if (ch == 18) // Ctrl-R: next older match, skipping repeats of the one shown
+        {
+            size_t older = editor.match == CommandHistory::npos ? commandHistory.size() : editor.match;
+            while ((older = commandHistory.searchBackward(editor.query, older)) != CommandHistory::npos &&
+                   commandHistory.entry(older) == editor.text)
+            {
+            }
+            if (older != CommandHistory::npos)
+            {
+                editor.match = older;
+                editor.text = std::string(commandHistory.entry(older));
+            }
+        }
+        else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8)
+        {
+            if (!editor.query.empty())
+                editor.query.pop_back();
+            editor.match = commandHistory.searchBackward(editor.query, commandHistory.size());
+            if (editor.match != CommandHistory::npos)
+                editor.text = std::string(commandHistory.entry(editor.match));
+        }
+        else if (ch == 27 || ch == 7) // Esc or Ctrl-G: back to the line as it was
+        {
+            editor.searching = false;
+            editor.text = editor.draft;
+        }
+        else if (ch >= 32 && ch < 127)
+        {
+            // The current match stays while it still contains the longer query
+            editor.query += static_cast<char>(ch);
+            size_t from = editor.match == CommandHistory::npos ? commandHistory.size() : editor.match + 1;
+            editor.match = commandHistory.searchBackward(editor.query, from);
+            if (editor.match != CommandHistory::npos)
+                editor.text = std::string(commandHistory.entry(editor.match));
+        }
+        else
+        {
+            // Any other key takes the match into the editor and acts there
+            editor.searching = false;
+            editor.cursor = editor.text.size();
+            return false;
+        }
+        editor.cursor = editor.text.size();
+        return true;
+    }
+
+    void handlePromptKey(int ch)
+    {
+        LineEditor &editor = lineEditor;
+        if (editor.searching && handleSearchKey(ch))
+        {
+            drawPrompt();
+            return;
+        }
+
+        std::string &text = editor.text;
+        size_t &cursor = editor.cursor;
+        switch (ch)
+        {
+        case '\n':
+        case '\r':
+        case KEY_ENTER:
+            closePrompt(true);
+            return;
+        case 27: // ESC
+            closePrompt(false);
+            return;
+        case 18: // Ctrl-R
+            editor.searching = true;
+            editor.query.clear();
+            editor.match = CommandHistory::npos;
+            editor.draft = text;
+            break;
+        case KEY_UP:
+        case KEY_DOWN:
+        {
+            size_t target = historyIndex;
+            if (ch == KEY_UP && target > 0)
+                target--;
+            else if (ch == KEY_DOWN && target < commandHistory.size())
+                target++;
+            if (target == historyIndex)
+                break;
+            if (historyIndex == commandHistory.size())
+                editor.draft = text;
+            historyIndex = target;
+            text = historyIndex == commandHistory.size() ? editor.draft : std::string(commandHistory.entry(historyIndex));
+            cursor = text.size();
+            break;
+        }
+        case '\t':
+            completeBranch(text, cursor);
+            break;
+        case KEY_LEFT:
+            if (cursor > 0)
+                cursor--;
+            break;
+        case KEY_RIGHT:
+            if (cursor < text.size())
+                cursor++;
+            break;
+        case KEY_HOME:
+        case 1: // Ctrl-A
+            cursor = 0;
+            break;
+        case KEY_END:
+        case 5: // Ctrl-E
+            cursor = text.size();
+            break;
+        case KEY_BACKSPACE:
+        case 127:
+        case 8:
+            if (cursor > 0)
+            {
+                text.erase(--cursor, 1);
+            }
+            break;
+        case KEY_DC:
+            if (cursor < text.size())
+            {
+                text.erase(cursor, 1);
+            }
+            break;
+        default:
+            if (ch >= 32 && ch < 127)
+            {
+                text.insert(cursor++, 1, static_cast<char>(ch));
+            }
+            break;
+        }
+        drawPrompt();
     }
 
     void loadJsonFiles()
@@ -1211,6 +2179,8 @@ private:
                 mi.label = item["label"].get<std::string>();
                 mi.command = item["command"].get<std::string>();
                 mi.description = item["description"].get<std::string>();
+                mi.listsBranches = (m.name == "Git" || m.name == "Branch") &&
+                                   (mi.label == "Switch Branch" || mi.label == "Checkout");
                 m.items.push_back(mi);
             }
             mainMenu.push_back(m);
@@ -1235,11 +2205,33 @@ private:
 public:
     GitNCurses() : historyIndex(0)
     {
+        if (const char *limit = getenv("GITNCURSES_SCROLLBACK_MB"))
+        {
+            scrollbackLimit = static_cast<size_t>(std::max(1L, atol(limit))) << 20;
+        }
+        if (const char *limit = getenv("GITNCURSES_OUTPUT_HISTORY"))
+        {
+            outputHistoryLimit = static_cast<size_t>(std::max(0L, atol(limit)));
+        }
+        // An empty GITNCURSES_HISTORY keeps the prompt history in memory only
+        const char *historyFile = getenv("GITNCURSES_HISTORY");
+        const char *home = getenv("HOME");
+        if (historyFile && *historyFile)
+        {
+            commandHistory.open(historyFile);
+        }
+        else if (!historyFile && home && *home)
+        {
+            commandHistory.open(std::string(home) + "/.gitncurses_history");
+        }
+        outputLines = std::make_unique<OutputBuffer>(256 * 1024, scrollbackLimit);
         initWindows();
     }
 
     ~GitNCurses()
     {
+        closeSubmenu();
+        renderer.setBaseWindows({});
         delwin(menuWin);
         delwin(outputWin);
         delwin(inputWin);
@@ -1249,43 +2241,159 @@ public:
 
     void run()
     {
-        // Clear output window and show empty state
-        wclear(outputWin);
-        box(outputWin, 0, 0);
-        wrefresh(outputWin);
+        // Show the empty output window
+        renderOutput();
+
+        // Nothing polls on a timer: the loop sleeps until a key, git output or a .git change arrives
+        eventLoop.setRedrawHandler([this]
+                                   { renderer.flush(); }, 33);
+        eventLoop.watch(STDIN_FILENO, [this]
+                        { readKeys(); });
+        eventLoop.watch(repoWatcher.fd(), [this]
+                        { repoWatcher.readEvents(); });
+        eventLoop.watch(repoWatcher.timerFd(), [this]
+                        { handleRepoChange(); });
+        eventLoop.watch(hud.timerFd(), [this]
+                        {
+                            hud.takeTick();
+                            updateHud();
+                        });
+        eventLoop.requestRedraw();
 
         while (true)
         {
-            int ch = wgetch(activeWindow);
-            if (ch == KEY_MOUSE)
+            if (!eventLoop.runOnce())
             {
-                // Handle mouse events if needed
-                continue;
+                // A signal interrupted poll; ncurses turns SIGWINCH into KEY_RESIZE on the next read
+                readKeys();
             }
+        }
+    }
+
+    void readKeys()
+    {
+        // Keys are read through stdscr, which is never drawn on, so wgetch never
+        // refreshes a window behind the renderer's back. Drain everything ncurses
+        // has buffered, stdin will not poll readable again for bytes it already read.
+        nodelay(stdscr, TRUE);
+        int ch;
+        while ((ch = wgetch(stdscr)) != ERR)
+        {
+            pendingKeys.push_back(ch);
+        }
+        // While a modal dialog is open it takes keys from the queue itself; keys typed ahead of it wait there
+        while (modalDepth == 0 && !pendingKeys.empty())
+        {
+            ch = pendingKeys.front();
+            pendingKeys.pop_front();
+            handleKey(ch);
+        }
+        eventLoop.requestRedraw();
+    }
 
+    // Modal dialogs read their keys here. The event loop keeps running underneath,
+    // so output streams, .git changes are handled and frames are drawn meanwhile.
+    int waitForKey()
+    {
+        modalDepth++;
+        int ch = ERR;
+        while (ch == ERR)
+        {
+            if (pendingKeys.empty())
+            {
+                // Show what the dialog drew before sleeping
+                eventLoop.requestRedraw();
+                if (!eventLoop.runOnce())
+                    readKeys();
+                continue;
+            }
+            ch = pendingKeys.front();
+            pendingKeys.pop_front();
             if (ch == KEY_RESIZE)
             {
                 resizeWindows();
-                continue;
+                ch = ERR;
             }
+        }
+        modalDepth--;
+        return ch;
+    }
+
+    void handleKey(int ch)
+    {
+        if (ch == KEY_MOUSE)
+        {
+            // Handle mouse events if needed
+            return;
+        }
+
+        if (ch == KEY_RESIZE)
+        {
+            resizeWindows();
+            return;
+        }
+
+        // The git> prompt has the keyboard until Enter or Esc
+        if (lineEditor.active)
+        {
+            handlePromptKey(ch);
+            return;
+        }
+
+        handleMenuInput(ch);
 
-            handleMenuInput(ch);
+        // Also allow direct command input
+        if (ch == '\n' && !showSubmenu && !isMenuActive && !lineEditor.active)
+        {
+            openPrompt(false);
+        }
+    }
 
-            // Also allow direct command input
-            if (ch == '\n' && !showSubmenu && !isMenuActive)
+    void handleRepoChange()
+    {
+        // Runs once a burst of events has settled; refresh only what depends on what changed
+        RepoChanges changes;
+        if (!repoWatcher.takeChanges(changes))
+            return;
+
+        unsigned stale = 0;
+        if (changes.head)
+        {
+            stale |= StateAll;
+        }
+        if (changes.index || changes.worktree)
+        {
+            stale |= StateDirty;
+        }
+        if (changes.refs)
+        {
+            // The current branch moving also changes what the index is compared against
+            const std::string &current = gitHandler.getRepoState().branch;
+            bool headMoved = changes.rescan ||
+                             std::find(changes.branches.begin(), changes.branches.end(), current) != changes.branches.end();
+            stale |= StateUpstream | (headMoved ? StateDirty : 0);
+            if (gitHandler.updateLocalBranches(changes))
             {
-                std::string command = getInput();
-                if (!command.empty())
-                {
-                    executeMenuCommand(command);
-                }
+                branchesStale = true;
             }
         }
+
+        gitHandler.invalidateRepoState(stale);
+        if (paneView)
+        {
+            paneView->repoChanged(changes);
+            watchPaneView();
+        }
+        updateStatusBar();
+        eventLoop.requestRedraw();
     }
 };
 
 int main()
 {
+    // A git child that exits before reading all of its stdin must not take us down with it
+    signal(SIGPIPE, SIG_IGN);
+
     GitNCurses app;
     app.run();
     return 0;